@@ -0,0 +1,72 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t blockSize)
+: blockSize(blockSize) {
+}
+
+FrameArena::~FrameArena() {
+    TrackMemory(nullptr);
+}
+
+void FrameArena::Reset() {
+    if (blocks.size() > 1) {
+        const auto capacity = GetCapacity();
+        if (account) {
+            account->Deallocate(capacity);
+        }
+        blocks.clear();
+        AddBlock(capacity);
+    }
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t FrameArena::GetCapacity() const {
+    size_t capacity = 0;
+    for (const auto &block: blocks) {
+        capacity += block.Size;
+    }
+    return capacity;
+}
+
+void FrameArena::TrackMemory(MemoryAccount *newAccount) {
+    const auto capacity = GetCapacity();
+    if (account) {
+        account->Deallocate(capacity);
+    }
+    account = newAccount;
+    if (account && capacity > 0) {
+        account->Allocate(capacity);
+    }
+}
+
+void FrameArena::AddBlock(size_t size) {
+    blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    if (account) {
+        account->Allocate(size);
+    }
+}
+
+void *FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    while (current < blocks.size()) {
+        auto &block = blocks[current];
+        const auto address = reinterpret_cast<uintptr_t>(block.Memory.get()) + offset;
+        const auto padding = (alignment - address % alignment) % alignment;
+        if (offset + padding + bytes <= block.Size) {
+            offset += padding + bytes;
+            used += bytes;
+            return block.Memory.get() + offset - bytes;
+        }
+        current++;
+        offset = 0;
+    }
+    const auto size = std::max({blockSize, bytes + alignment, blocks.empty() ? 0 : 2 * blocks.back().Size});
+    AddBlock(size);
+    current = blocks.size() - 1;
+    offset = 0;
+    return do_allocate(bytes, alignment);
+}
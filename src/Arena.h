@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Memory.h"
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Monotonic bump allocator for scratch memory that lives for one frame or one broadphase rebuild. Deallocation
+// is a no-op and Reset recycles everything at once. Blocks are kept across resets, so once the arena has grown
+// to the peak usage of a frame, later frames never touch the heap.
+class FrameArena : public std::pmr::memory_resource {
+public:
+    explicit FrameArena(size_t blockSize = 64 * 1024);
+    ~FrameArena() override;
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // Everything allocated since the last reset becomes invalid. If the last frame spilled into several blocks
+    // they are merged into one block large enough for all of it.
+    void Reset();
+
+    [[nodiscard]] size_t GetUsed() const { return used; }
+
+    [[nodiscard]] size_t GetCapacity() const;
+
+    // Charges the blocks, held now and later, to account instead of the previous one.
+    void TrackMemory(MemoryAccount *newAccount);
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    struct Block {
+        std::unique_ptr<std::byte[]> Memory;
+        size_t Size = 0;
+    };
+
+    void AddBlock(size_t size);
+
+    std::vector<Block> blocks;
+    MemoryAccount *account = nullptr;
+    size_t blockSize;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t used = 0;
+};
@@ -0,0 +1,165 @@
+#include "Autotuner.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+// An asynchronous rebuild runs beside the other phases and barely shows in QueryWaitTime, its own duration is
+// counted instead so the query settings are not chosen on noise. Rebuilds with a skin are synchronous.
+double FrameCost(const PhysimConfig& config, const PhysimStats& stats) {
+    const bool asyncRebuild = config.AsyncQuery && config.Skin <= 0.0f;
+    return stats.VelocityTime + stats.QueryWaitTime + stats.SolveTime + (asyncRebuild ? stats.RebuildTime : 0.0);
+}
+
+struct TunedValue {
+    const char* Name;
+    float (*Get)(const PhysimConfig&);
+    void (*Set)(PhysimConfig&, float);
+};
+
+const TunedValue tunedValues[] = {
+        {"QueryParts", [](const PhysimConfig& c) { return static_cast<float>(c.QueryParts); },
+         [](PhysimConfig& c, float v) { c.QueryParts = static_cast<int>(v); }},
+        {"LeafSize", [](const PhysimConfig& c) { return static_cast<float>(c.LeafSize); },
+         [](PhysimConfig& c, float v) { c.LeafSize = static_cast<uint32_t>(v); }},
+        {"QueryRadius", [](const PhysimConfig& c) { return c.QueryRadius; },
+         [](PhysimConfig& c, float v) { c.QueryRadius = v; }},
+        {"Skin", [](const PhysimConfig& c) { return c.Skin; },
+         [](PhysimConfig& c, float v) { c.Skin = v; }},
+        {"NrIterations", [](const PhysimConfig& c) { return static_cast<float>(c.NrIterations); },
+         [](PhysimConfig& c, float v) { c.NrIterations = static_cast<int>(v); }},
+};
+
+const TunedValue* FindTunedValue(const std::string& name) {
+    for (const auto& tuned: tunedValues) {
+        if (name == tuned.Name) {
+            return &tuned;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+Autotuner::Autotuner(const PhysimConfig& base, const AutotunerSettings& settings)
+: settings(settings)
+, best(base)
+, current(base) {
+    auto add = [&](const char* name, std::vector<float> values) {
+        const auto* tuned = FindTunedValue(name);
+        parameters.push_back({.Name=name, .Values=std::move(values),
+                              .Apply=[tuned](PhysimConfig& config, float v) { tuned->Set(config, v); }});
+    };
+    add("QueryParts", {1, 2, 4, 8, 16, 32});
+    add("LeafSize", {4, 8, 16, 32, 64});
+    if (base.Skin > 0.0f) {
+        add("Skin", {base.Skin, 1.5f * base.Skin, 2.0f * base.Skin, 3.0f * base.Skin});
+    } else {
+        add("QueryRadius", {base.QueryRadius, 1.5f * base.QueryRadius, 2.0f * base.QueryRadius});
+    }
+    if (settings.MinIterations > 0 && settings.MinIterations < base.NrIterations) {
+        std::vector<float> iterations;
+        for (int i = base.NrIterations; i >= settings.MinIterations; i--) {
+            iterations.push_back(static_cast<float>(i));
+        }
+        add("NrIterations", iterations);
+    }
+    Start(0);
+}
+
+void Autotuner::Start(size_t newValue) {
+    value = newValue;
+    frame = 0;
+    costs.clear();
+    current = best;
+    parameters[parameter].Apply(current, parameters[parameter].Values[value]);
+}
+
+const PhysimConfig& Autotuner::Update(const PhysimStats& stats) {
+    if (IsDone()) {
+        return best;
+    }
+    if (frame++ >= settings.WarmupFrames) {
+        costs.push_back(FrameCost(current, stats));
+    }
+    if (static_cast<int>(costs.size()) < settings.MeasuredFrames) {
+        return current;
+    }
+    auto& tuning = parameters[parameter];
+    const auto middle = costs.begin() + static_cast<std::ptrdiff_t>(costs.size() / 2);
+    std::nth_element(costs.begin(), middle, costs.end());
+    tuning.Medians.push_back(*middle);
+    if (tuning.Medians.back() < tuning.Medians[tuning.Best]) {
+        tuning.Best = value;
+    }
+    if (value + 1 < tuning.Values.size()) {
+        Start(value + 1);
+        return current;
+    }
+    tuning.Apply(best, tuning.Values[tuning.Best]);
+    if (++parameter < parameters.size()) {
+        Start(0);
+        return current;
+    }
+    return best;
+}
+
+bool Autotuner::IsDone() const {
+    return parameter >= parameters.size();
+}
+
+const PhysimConfig& Autotuner::GetBest() const {
+    return best;
+}
+
+std::vector<std::string> Autotuner::GetTunedNames() const {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < std::min(parameter, parameters.size()); i++) {
+        names.push_back(parameters[i].Name);
+    }
+    return names;
+}
+
+int Autotuner::GetTotalFrames() const {
+    int total = 0;
+    for (const auto& tuning: parameters) {
+        total += static_cast<int>(tuning.Values.size()) * (settings.WarmupFrames + settings.MeasuredFrames);
+    }
+    return total;
+}
+
+void Autotuner::Report(std::ostream& out) const {
+    for (const auto& tuning: parameters) {
+        if (tuning.Medians.empty()) {
+            out << tuning.Name << ": not tuned yet\n";
+            continue;
+        }
+        out << tuning.Name << ": " << tuning.Values[tuning.Best] << " (" << tuning.Medians[tuning.Best] * 1000.0
+            << " ms per frame)\n";
+    }
+}
+
+bool SaveTunedConfig(const std::filesystem::path& path, const Autotuner& tuner) {
+    std::ofstream file(path);
+    for (const auto& name: tuner.GetTunedNames()) {
+        file << name << " " << FindTunedValue(name)->Get(tuner.GetBest()) << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+std::optional<PhysimConfig> LoadTunedConfig(const std::filesystem::path& path, const PhysimConfig& base) {
+    std::ifstream file(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    auto config = base;
+    std::string name;
+    float value = 0.0f;
+    while (file >> name >> value) {
+        if (const auto* tuned = FindTunedValue(name)) {
+            tuned->Set(config, value);
+        }
+    }
+    return config;
+}
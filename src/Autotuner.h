@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Util.h"
+#include "PhysimPolicies.h"
+#include "PhysimStats.h"
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Searches the PhysimConfig values that trade speed for nothing or for bounded accuracy during the first frames
+// of a run: QueryParts, LeafSize, the neighbour margin (Skin when a skin is in use, otherwise QueryRadius, never
+// below the configured value) and, when allowed, NrIterations down to MinIterations. Parameters are tuned one at
+// a time, every candidate runs for a few warm up frames and is then scored by the median of the phase times of
+// the measured frames, including the background rebuild with AsyncQuery, and the fastest value is kept before
+// moving on to the next parameter.
+struct AutotunerSettings {
+    int WarmupFrames = 3;
+    int MeasuredFrames = 20;
+    // Fewest substeps the tuner may choose, zero keeps the configured NrIterations.
+    int MinIterations = 0;
+};
+
+class Autotuner {
+public:
+    explicit Autotuner(const PhysimConfig& base, const AutotunerSettings& settings = {});
+
+    // Call after every Run with its stats, returns the config to run the next frame with. Once done it keeps
+    // returning the best config.
+    const PhysimConfig& Update(const PhysimStats& stats);
+
+    [[nodiscard]] bool IsDone() const;
+
+    // The fastest config found so far, the final choice once IsDone.
+    [[nodiscard]] const PhysimConfig& GetBest() const;
+
+    // Parameters whose search has finished, in the order they were tuned.
+    [[nodiscard]] std::vector<std::string> GetTunedNames() const;
+
+    // Frames needed for the whole search.
+    [[nodiscard]] int GetTotalFrames() const;
+
+    // One line per tuned parameter with the chosen value and its median frame time.
+    void Report(std::ostream& out) const;
+
+private:
+    struct Parameter {
+        std::string Name{};
+        std::vector<float> Values{};
+        std::function<void(PhysimConfig&, float)> Apply{};
+        std::vector<double> Medians{};
+        size_t Best = 0;
+    };
+
+    void Start(size_t value);
+
+    AutotunerSettings settings;
+    PhysimConfig best;
+    PhysimConfig current;
+    std::vector<Parameter> parameters;
+    size_t parameter = 0;
+    size_t value = 0;
+    int frame = 0;
+    std::vector<double> costs;
+};
+
+// The best values of the parameters the tuner has finished as "Name value" lines, everything else in the config
+// is left out so later changes to its defaults still apply. Returns false when the file could not be written.
+bool SaveTunedConfig(const std::filesystem::path& path, const Autotuner& tuner);
+
+// Applies the values saved by SaveTunedConfig to base, nullopt when the file can not be read.
+std::optional<PhysimConfig> LoadTunedConfig(const std::filesystem::path& path, const PhysimConfig& base);
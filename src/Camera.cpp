@@ -0,0 +1,111 @@
+#include "Camera.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float minPixelsPerUnit = 0.01f;
+constexpr float maxPixelsPerUnit = 64.0f;
+
+}
+
+Camera::Camera(const WorldBoundrarys &worldBoundrarys, sf::Vector2u windowSize)
+        : worldBoundrarys(worldBoundrarys)
+        , windowSize(static_cast<float>(windowSize.x), static_cast<float>(windowSize.y))
+        , center(worldBoundrarys.Position + worldBoundrarys.Size * 0.5f) {
+}
+
+void Camera::Pan(sf::Vector2f pixels) {
+    center -= pixels / pixelsPerUnit;
+    const auto box = worldBoundrarys.GetBox();
+    center.x = std::clamp(center.x, box.left, box.left + box.width);
+    center.y = std::clamp(center.y, box.top, box.top + box.height);
+}
+
+void Camera::Zoom(float factor, sf::Vector2i pixel) {
+    const auto anchor = ToWorld(pixel);
+    pixelsPerUnit = std::clamp(pixelsPerUnit * factor, minPixelsPerUnit, maxPixelsPerUnit);
+    center += anchor - ToWorld(pixel);
+}
+
+void Camera::Resize(sf::Vector2u newWindowSize) {
+    windowSize = {static_cast<float>(newWindowSize.x), static_cast<float>(newWindowSize.y)};
+}
+
+sf::Vector2f Camera::ToWorld(sf::Vector2i pixel) const {
+    const sf::Vector2f offset{static_cast<float>(pixel.x) - windowSize.x * 0.5f,
+                              static_cast<float>(pixel.y) - windowSize.y * 0.5f};
+    return center + offset / pixelsPerUnit;
+}
+
+sf::View Camera::GetView() const {
+    sf::View view;
+    view.setCenter(center);
+    view.setSize(windowSize / pixelsPerUnit);
+    return view;
+}
+
+sf::FloatRect Camera::GetVisibleArea() const {
+    const auto size = windowSize / pixelsPerUnit;
+    return {center - size * 0.5f, size};
+}
+
+float Camera::GetPixelsPerUnit() const {
+    return pixelsPerUnit;
+}
+
+void DensityLayer::Begin(sf::FloatRect newArea, sf::Vector2u windowSize) {
+    area = newArea;
+    const auto newColumns = std::max(1u, windowSize.x / texelSize);
+    const auto newRows = std::max(1u, windowSize.y / texelSize);
+    if (newColumns != columns || newRows != rows) {
+        columns = newColumns;
+        rows = newRows;
+        pixels.resize(columns * rows * 4);
+        texture.create(columns, rows);
+    }
+    texelsPerUnit = {static_cast<float>(columns) / area.width, static_cast<float>(rows) / area.height};
+    texels.assign(columns * rows, {});
+}
+
+void DensityLayer::Splat(sf::Vector2f position, sf::Color color) {
+    const auto column = static_cast<int>((position.x - area.left) * texelsPerUnit.x);
+    const auto row = static_cast<int>((position.y - area.top) * texelsPerUnit.y);
+    if (column < 0 || row < 0 || column >= static_cast<int>(columns) || row >= static_cast<int>(rows)) {
+        return;
+    }
+    auto &texel = texels[row * columns + column];
+    texel.Count++;
+    texel.Red += color.r;
+    texel.Green += color.g;
+    texel.Blue += color.b;
+}
+
+void DensityLayer::Draw(sf::RenderWindow &window) {
+    uint32_t maxCount = 0;
+    for (const auto &texel: texels) {
+        maxCount = std::max(maxCount, texel.Count);
+    }
+    // Texels show the average color of their circles, with an opacity that grows logarithmically with the count
+    // so sparse regions stay visible next to dense ones.
+    const float scale = maxCount > 0 ? 1.0f / std::log1p(static_cast<float>(maxCount)) : 0.0f;
+    for (size_t i = 0; i < texels.size(); i++) {
+        const auto &texel = texels[i];
+        auto *pixel = &pixels[i * 4];
+        if (texel.Count == 0) {
+            std::fill(pixel, pixel + 4, 0);
+            continue;
+        }
+        pixel[0] = static_cast<uint8_t>(texel.Red / texel.Count);
+        pixel[1] = static_cast<uint8_t>(texel.Green / texel.Count);
+        pixel[2] = static_cast<uint8_t>(texel.Blue / texel.Count);
+        pixel[3] = static_cast<uint8_t>(80 + 175 * std::log1p(static_cast<float>(texel.Count)) * scale);
+    }
+    texture.update(pixels.data());
+
+    sf::Sprite sprite(texture);
+    sprite.setPosition(area.left, area.top);
+    sprite.setScale(1.0f / texelsPerUnit.x, 1.0f / texelsPerUnit.y);
+    window.draw(sprite);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Util.h"
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// Pan and zoom over the world. A zoom of one maps one world unit to one pixel, which is how the window was
+// laid out before there was a camera.
+class Camera {
+public:
+    Camera(const WorldBoundrarys &worldBoundrarys, sf::Vector2u windowSize);
+
+    void Pan(sf::Vector2f pixels);
+
+    // Scales the zoom by factor while keeping the world point under pixel in place.
+    void Zoom(float factor, sf::Vector2i pixel);
+
+    void Resize(sf::Vector2u windowSize);
+
+    [[nodiscard]] sf::Vector2f ToWorld(sf::Vector2i pixel) const;
+
+    [[nodiscard]] sf::View GetView() const;
+
+    [[nodiscard]] sf::FloatRect GetVisibleArea() const;
+
+    [[nodiscard]] float GetPixelsPerUnit() const;
+
+private:
+    WorldBoundrarys worldBoundrarys;
+    sf::Vector2f windowSize;
+    sf::Vector2f center;
+    float pixelsPerUnit = 1.0f;
+};
+
+// Level of detail for zoomed out views. Circles are splatted into a texture with one texel per texelSize
+// pixels of the visible area and drawn as a single sprite, so the draw cost stays fixed by the window size
+// however many circles are visible.
+class DensityLayer {
+public:
+    static constexpr unsigned texelSize = 2;
+
+    void Begin(sf::FloatRect area, sf::Vector2u windowSize);
+
+    void Splat(sf::Vector2f position, sf::Color color);
+
+    void Draw(sf::RenderWindow &window);
+
+private:
+    struct Texel {
+        uint32_t Count = 0;
+        uint32_t Red = 0;
+        uint32_t Green = 0;
+        uint32_t Blue = 0;
+    };
+
+    sf::FloatRect area;
+    unsigned columns = 0;
+    unsigned rows = 0;
+    sf::Vector2f texelsPerUnit;
+    std::vector<Texel> texels;
+    std::vector<uint8_t> pixels;
+    sf::Texture texture;
+};
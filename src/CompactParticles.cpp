@@ -0,0 +1,316 @@
+#include "CompactParticles.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+
+constexpr float fixedScale = 65536.0f;
+
+uint16_t ToFixed(float fraction) {
+    return static_cast<uint16_t>(std::clamp(std::lround(fraction * fixedScale), 0l, 65535l));
+}
+
+uint16_t CellCount(float size, float cellSize) {
+    return static_cast<uint16_t>(std::clamp(std::ceil(size / cellSize), 1.0f, 65535.0f));
+}
+
+}
+
+// Rounds by adding half an ulp of the target precision, with the odd bit so ties go to even. Results below the
+// smallest normal half are produced by letting the float addition shift the mantissa into place.
+uint16_t ToHalf(float value) {
+    constexpr uint32_t infinity = 255u << 23;
+    constexpr uint32_t beyondHalf = (127u + 16u) << 23;
+    constexpr uint32_t subnormalMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    auto bits = std::bit_cast<uint32_t>(value);
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+    uint32_t half;
+    if (bits >= beyondHalf) {
+        half = bits > infinity ? 0x7e00u : 0x7c00u;
+    } else if (bits < (113u << 23)) {
+        const auto shifted = std::bit_cast<float>(bits) + std::bit_cast<float>(subnormalMagic);
+        half = std::bit_cast<uint32_t>(shifted) - subnormalMagic;
+    } else {
+        const uint32_t odd = (bits >> 13) & 1u;
+        bits += ((15u - 127u) << 23) + 0xfffu + odd;
+        half = bits >> 13;
+    }
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+float FromHalf(uint16_t half) {
+    constexpr uint32_t exponentMask = 0x7c00u << 13;
+    uint32_t bits = (half & 0x7fffu) << 13;
+    const uint32_t exponent = bits & exponentMask;
+    bits += (127u - 15u) << 23;
+    if (exponent == exponentMask) {
+        bits += (128u - 16u) << 23;
+    } else if (exponent == 0) {
+        bits += 1u << 23;
+        bits = std::bit_cast<uint32_t>(std::bit_cast<float>(bits) - std::bit_cast<float>(113u << 23));
+    }
+    return std::bit_cast<float>(bits | (static_cast<uint32_t>(half & 0x8000u) << 16));
+}
+
+CompactParticles::CompactParticles(const WorldBoundrarys& worldBoundrarys, const CompactConfig& config)
+: area(worldBoundrarys.GetBox())
+, config(config)
+, columns(CellCount(area.width, config.CellSize))
+, rows(CellCount(area.height, config.CellSize)) {
+}
+
+bool CompactParticles::Add(const ParticleRecord& record) {
+    if (2.0f * record.Radius > config.CellSize) {
+        return false;
+    }
+    const CompactMaterial wanted{record.Radius, record.Color, record.Mass, record.Bounciness, record.Friction};
+    auto found = std::find(palette.begin(), palette.end(), wanted);
+    if (found == palette.end()) {
+        if (palette.size() == maxMaterials) {
+            return false;
+        }
+        found = palette.insert(palette.end(), wanted);
+    }
+    material.push_back(static_cast<uint8_t>(found - palette.begin()));
+    column.push_back(0);
+    row.push_back(0);
+    x.push_back(0);
+    y.push_back(0);
+    velocityX.push_back(0);
+    velocityY.push_back(0);
+    const auto i = Size() - 1;
+    sorted = false;
+    SetPosition(i, record.Position);
+    SetVelocity(i, record.Velocity);
+    if (config.KeepPrevious) {
+        const auto step = GetPosition(i) - record.PreviousPosition;
+        stepX.push_back(ToHalf(step.x));
+        stepY.push_back(ToHalf(step.y));
+    }
+    return true;
+}
+
+ParticleRecord CompactParticles::Get(size_t i) const {
+    const auto& look = palette[material[i]];
+    const auto position = GetPosition(i);
+    auto previous = position;
+    if (config.KeepPrevious) {
+        previous -= sf::Vector2f{FromHalf(stepX[i]), FromHalf(stepY[i])};
+    }
+    return {position, GetVelocity(i), previous, look.Radius, look.Mass, look.Bounciness, look.Friction, look.Color};
+}
+
+sf::Vector2f CompactParticles::GetPosition(size_t i) const {
+    return {area.left + (static_cast<float>(column[i]) + static_cast<float>(x[i]) / fixedScale) * config.CellSize,
+            area.top + (static_cast<float>(row[i]) + static_cast<float>(y[i]) / fixedScale) * config.CellSize};
+}
+
+size_t CompactParticles::GetBytesPerParticle() const {
+    // The state, then the sort's order and the gather buffers for the 16 and 8 bit fields.
+    size_t bytes = sizeof(uint16_t) * 6 + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t);
+    if (config.KeepPrevious) {
+        bytes += sizeof(uint16_t) * 2;
+    }
+    return bytes;
+}
+
+void CompactParticles::Clear() {
+    palette.clear();
+    for (auto* values: {&column, &row, &x, &y, &velocityX, &velocityY, &stepX, &stepY}) {
+        values->clear();
+    }
+    material.clear();
+    sorted = false;
+}
+
+void CompactParticles::Accelerate(sf::Vector2f acceleration, float dt) {
+    const auto change = acceleration * dt;
+    for (size_t i = 0; i < Size(); i++) {
+        velocityX[i] = ToHalf(FromHalf(velocityX[i]) + change.x);
+        velocityY[i] = ToHalf(FromHalf(velocityY[i]) + change.y);
+    }
+}
+
+void CompactParticles::Run(float dt) {
+    const float dtPart = dt / static_cast<float>(config.NrIterations);
+    for (int i = 0; i < config.NrIterations; i++) {
+        Step(dtPart);
+        if (!sorted) {
+            SortByCell();
+        }
+        Collide();
+        for (size_t particle = 0; particle < Size(); particle++) {
+            Bounds(particle);
+        }
+    }
+}
+
+void CompactParticles::Step(float dt) {
+    for (size_t i = 0; i < Size(); i++) {
+        auto velocity = GetVelocity(i);
+        const float speed = sf::getLength(velocity);
+        if (speed > Verlet::maxSpeed) {
+            velocity *= Verlet::maxSpeed / speed;
+            SetVelocity(i, velocity);
+        }
+        const auto step = velocity * dt;
+        SetPosition(i, GetPosition(i) + step);
+        if (config.KeepPrevious) {
+            stepX[i] = ToHalf(step.x);
+            stepY[i] = ToHalf(step.y);
+        }
+    }
+}
+
+// Counting sort, the counts are accumulated one cell ahead so the starts are left in place after the scatter
+// has advanced each of them to the next cell's start. Every field is then gathered into the sorted order, so
+// the circles of a cell and of the cells next to it in the same row are contiguous.
+void CompactParticles::SortByCell() {
+    const size_t nrCells = static_cast<size_t>(columns) * rows;
+    cellStart.assign(nrCells + 1, 0);
+    for (size_t i = 0; i < Size(); i++) {
+        cellStart[CellOf(i) + 1]++;
+    }
+    for (size_t cell = 0; cell < nrCells; cell++) {
+        cellStart[cell + 1] += cellStart[cell];
+    }
+    order.resize(Size());
+    for (size_t i = 0; i < Size(); i++) {
+        order[cellStart[CellOf(i)]++] = static_cast<uint32_t>(i);
+    }
+    for (size_t cell = nrCells; cell > 0; cell--) {
+        cellStart[cell] = cellStart[cell - 1];
+    }
+    cellStart[0] = 0;
+
+    auto gather = [&](auto& values, auto& sorted) {
+        sorted.resize(values.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            sorted[i] = values[order[i]];
+        }
+        values.swap(sorted);
+    };
+    for (auto* values: {&column, &row, &x, &y, &velocityX, &velocityY}) {
+        gather(*values, sorted16);
+    }
+    if (config.KeepPrevious) {
+        gather(stepX, sorted16);
+        gather(stepY, sorted16);
+    }
+    gather(material, sorted8);
+    sorted = true;
+}
+
+// Every pair is resolved once, from the circle with the lower index. With the circles sorted by cell, that
+// leaves the rest of its own cell and the cell to the right as one range, and the three cells below as another.
+void CompactParticles::Collide() {
+    for (uint16_t cellRow = 0; cellRow < rows; cellRow++) {
+        for (uint16_t cellColumn = 0; cellColumn < columns; cellColumn++) {
+            const size_t cell = static_cast<size_t>(cellRow) * columns + cellColumn;
+            const size_t right = cellColumn + 1 < columns ? cell + 1 : cell;
+            const size_t below = cell + columns;
+            const size_t belowLeft = cellColumn > 0 ? below - 1 : below;
+            const size_t belowRight = cellColumn + 1 < columns ? below + 1 : below;
+            for (auto i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+                Collide(i, i + 1, cellStart[right + 1]);
+                if (cellRow + 1 < rows) {
+                    Collide(i, cellStart[belowLeft], cellStart[belowRight + 1]);
+                }
+            }
+        }
+    }
+}
+
+// Moves each circle by its mass share of the overlap and reflects the closing velocity with the lower
+// bounciness of the two. Friction, again the lower of the two, then takes out tangential velocity, at most
+// friction times the normal impulse.
+void CompactParticles::Collide(size_t i, size_t begin, size_t end) {
+    const auto& material1 = palette[material[i]];
+    auto position1 = GetPosition(i);
+    for (size_t j = begin; j < end; j++) {
+        const auto& material2 = palette[material[j]];
+        const auto position2 = GetPosition(j);
+        const auto offset = position1 - position2;
+        const float reach = material1.Radius + material2.Radius;
+        const float distanceSquared = offset.x * offset.x + offset.y * offset.y;
+        if (distanceSquared >= reach * reach) {
+            continue;
+        }
+        const float distance = std::sqrt(distanceSquared);
+        const float penetration = reach - distance;
+        const auto normal = distance > 0.0f ? offset / distance : sf::Vector2f{1.0f, 0.0f};
+        const float totalMass = material1.Mass + material2.Mass;
+        SetPosition(i, position1 + normal * (penetration * material2.Mass / totalMass));
+        SetPosition(j, position2 - normal * (penetration * material1.Mass / totalMass));
+        position1 = GetPosition(i);
+
+        const auto velocity1 = GetVelocity(i);
+        const auto velocity2 = GetVelocity(j);
+        const auto relative = velocity1 - velocity2;
+        const float closing = relative.x * normal.x + relative.y * normal.y;
+        if (closing < 0.0f) {
+            const float inverseMass = 1.0f / material1.Mass + 1.0f / material2.Mass;
+            const float bounciness = std::min(material1.Bounciness, material2.Bounciness);
+            const float impulse = -(1.0f + bounciness) * closing / inverseMass;
+            const sf::Vector2f tangent{-normal.y, normal.x};
+            const float sliding = relative.x * tangent.x + relative.y * tangent.y;
+            const float friction = std::min(material1.Friction, material2.Friction) * impulse;
+            const float tangentImpulse = std::clamp(-sliding / inverseMass, -friction, friction);
+            const auto change = normal * impulse + tangent * tangentImpulse;
+            SetVelocity(i, velocity1 + change / material1.Mass);
+            SetVelocity(j, velocity2 - change / material2.Mass);
+        }
+    }
+}
+
+void CompactParticles::Bounds(size_t i) {
+    const auto& look = palette[material[i]];
+    auto position = GetPosition(i);
+    auto velocity = GetVelocity(i);
+    bool moved = false;
+    auto bounce = [&](float& coordinate, float& speed, float min, float max) {
+        if (coordinate < min) {
+            coordinate = min;
+            speed = std::abs(speed) * look.Bounciness;
+            moved = true;
+        } else if (coordinate > max) {
+            coordinate = max;
+            speed = -std::abs(speed) * look.Bounciness;
+            moved = true;
+        }
+    };
+    bounce(position.x, velocity.x, area.left + look.Radius, area.left + area.width - look.Radius);
+    bounce(position.y, velocity.y, area.top + look.Radius, area.top + area.height - look.Radius);
+    if (moved) {
+        SetPosition(i, position);
+        SetVelocity(i, velocity);
+    }
+}
+
+sf::Vector2f CompactParticles::GetVelocity(size_t i) const {
+    return {FromHalf(velocityX[i]), FromHalf(velocityY[i])};
+}
+
+void CompactParticles::SetVelocity(size_t i, sf::Vector2f velocity) {
+    velocityX[i] = ToHalf(velocity.x);
+    velocityY[i] = ToHalf(velocity.y);
+}
+
+void CompactParticles::SetPosition(size_t i, sf::Vector2f position) {
+    const float localX = std::clamp((position.x - area.left) / config.CellSize, 0.0f,
+                                    static_cast<float>(columns) - 1.0f / fixedScale);
+    const float localY = std::clamp((position.y - area.top) / config.CellSize, 0.0f,
+                                    static_cast<float>(rows) - 1.0f / fixedScale);
+    const auto newColumn = static_cast<uint16_t>(localX);
+    const auto newRow = static_cast<uint16_t>(localY);
+    if (newColumn != column[i] || newRow != row[i]) {
+        sorted = false;
+    }
+    column[i] = newColumn;
+    row[i] = newRow;
+    x[i] = ToFixed(localX - static_cast<float>(column[i]));
+    y[i] = ToFixed(localY - static_cast<float>(row[i]));
+}
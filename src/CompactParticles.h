@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Util.h"
+#include "ParticleRecord.h"
+#include <cstdint>
+#include <vector>
+
+// IEEE half precision, rounded to nearest even. Values beyond the half range become infinity.
+uint16_t ToHalf(float value);
+
+float FromHalf(uint16_t half);
+
+struct CompactConfig {
+    // Side of the cells positions are stored relative to. At least the largest diameter, collisions only look
+    // at the neighbouring cells.
+    float CellSize = 4.0f * circleRadius;
+    int NrIterations = nrIterations;
+    // Keep the position before the last step, needed when the particles go back into an ECS that runs
+    // continuous collision. Dropped otherwise.
+    bool KeepPrevious = false;
+};
+
+// Look and material shared by every particle with the same palette index.
+struct CompactMaterial {
+    float Radius = 0.0f;
+    uint32_t Color = 0;
+    float Mass = 1.0f;
+    float Bounciness = 0.0f;
+    float Friction = 0.0f;
+
+    bool operator==(const CompactMaterial&) const = default;
+};
+
+// Particle state quantized for worlds too large for a Verlet and Circle per particle, stored as one array per
+// field. Positions are a cell column and row plus a 16 bit fixed point offset inside the cell, velocities are
+// half precision and everything else is one byte indexing a palette of at most 256 materials, 13 bytes per
+// particle, 17 with KeepPrevious where the last step is kept as a half precision offset. Sorting needs another
+// 7 bytes of scratch per particle.
+//
+// Run integrates and collides the particles on this representation directly. Before a substep collides, the
+// particles are sorted by cell if any of them changed cell since the last sort, so indices change between runs.
+// Circles are then resolved pairwise within the 3x3 neighbouring cells, with friction on their tangential
+// velocity, and bounced off the world's edges. Lines are not supported, pack only the parts of a world without
+// them.
+class CompactParticles {
+public:
+    static constexpr size_t maxMaterials = 256;
+
+    explicit CompactParticles(const WorldBoundrarys& worldBoundrarys, const CompactConfig& config = {});
+
+    // Returns false when the record needs a material beyond maxMaterials or is wider than CellSize, collisions
+    // would miss it. Positions are clamped into the world.
+    bool Add(const ParticleRecord& record);
+
+    [[nodiscard]] ParticleRecord Get(size_t i) const;
+
+    [[nodiscard]] sf::Vector2f GetPosition(size_t i) const;
+
+    [[nodiscard]] size_t Size() const {
+        return material.size();
+    }
+
+    [[nodiscard]] const std::vector<CompactMaterial>& GetPalette() const {
+        return palette;
+    }
+
+    [[nodiscard]] size_t GetBytesPerParticle() const;
+
+    void Clear();
+
+    // Adds acceleration * dt to every velocity, for gravity and other uniform fields.
+    void Accelerate(sf::Vector2f acceleration, float dt);
+
+    void Run(float dt);
+
+    // Copies every circle of the ECS in, and builds entities from the compact state.
+    template <typename TEcs>
+    void Pack(TEcs& ecs) {
+        for (const auto& [circle, verlet]: ecs.template GetSystem<Circle, Verlet>()) {
+            if (!verlet.Parked) {
+                Add(MakeParticleRecord(circle, verlet));
+            }
+        }
+    }
+
+    template <typename TEcs>
+    void Unpack(TEcs& ecs) const {
+        for (size_t i = 0; i < Size(); i++) {
+            BuildParticle(ecs, Get(i));
+        }
+    }
+
+private:
+    void Step(float dt);
+
+    void SortByCell();
+
+    void Collide();
+
+    void Collide(size_t i, size_t begin, size_t end);
+
+    void Bounds(size_t i);
+
+    [[nodiscard]] sf::Vector2f GetVelocity(size_t i) const;
+
+    void SetVelocity(size_t i, sf::Vector2f velocity);
+
+    void SetPosition(size_t i, sf::Vector2f position);
+
+    [[nodiscard]] size_t CellOf(size_t i) const {
+        return static_cast<size_t>(row[i]) * columns + column[i];
+    }
+
+    const sf::FloatRect area;
+    const CompactConfig config;
+    const uint16_t columns;
+    const uint16_t rows;
+    std::vector<CompactMaterial> palette;
+    std::vector<uint16_t> column;
+    std::vector<uint16_t> row;
+    std::vector<uint16_t> x;
+    std::vector<uint16_t> y;
+    std::vector<uint16_t> velocityX;
+    std::vector<uint16_t> velocityY;
+    // Offset from the previous position to the current one, only filled with KeepPrevious.
+    std::vector<uint16_t> stepX;
+    std::vector<uint16_t> stepY;
+    std::vector<uint8_t> material;
+    // Where each cell starts in the particles, valid while sorted, and scratch for the sort.
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> order;
+    std::vector<uint16_t> sorted16;
+    std::vector<uint8_t> sorted8;
+    // Cleared whenever a particle is added or moves to another cell.
+    bool sorted = false;
+};
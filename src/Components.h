@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "Memory.h"
 #include "SFML/Graphics.hpp"
 #include <SFMLMath.hpp>
 #include <octree-cpp/OctreeCpp.h>
@@ -21,6 +22,8 @@ struct Line {
 };
 
 struct Verlet {
+    static constexpr float maxSpeed = 100.0f;
+
     sf::Vector2f Position;
     sf::Vector2f Acceleration;
     sf::Vector2f Velocity;
@@ -28,6 +31,8 @@ struct Verlet {
     float Mass = 1.0;
     float Bounciness = 0.9f;
     float Friction = 0.5;
+    // Set on the circles a ParticlePool parks. Nothing integrates, queries, solves, packs or exports them.
+    bool Parked = false;
 
     void MaxVelocity(float max) {
         if (sf::getLength(Velocity) > max) {
@@ -36,12 +41,26 @@ struct Verlet {
     }
 
     void Update(float dt) {
-        MaxVelocity(100.0f);
+        MaxVelocity(maxSpeed);
         Position += Velocity * dt;
     }
 };
 
-using octreeQuery = std::vector<DataWrapper<sf::Vector2f, ecs::EntityID>>;
+// Spawns Rate circles per second through a ParticlePool, uniformly inside Region and with Velocity plus a
+// uniform random offset of up to Spread on each axis.
+struct Emitter {
+    float Rate = 0.0f;
+    sf::FloatRect Region;
+    sf::Vector2f Velocity;
+    sf::Vector2f Spread;
+    Circle Particle;
+    // Fraction of a circle carried over to the next frame, and the circles due this frame.
+    float Carry = 0.0f;
+    int Due = 0;
+};
+
+// Charges the account of its allocator, PhysimCpp gives the lists it rebuilds its own.
+using octreeQuery = TrackedVector<DataWrapper<sf::Vector2f, ecs::EntityID>>;
 struct OctreeSwitch {
     bool UpdatingOne = false;
     octreeQuery Query1;
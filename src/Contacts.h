@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Memory.h"
+#include <ecs-cpp/EcsCpp.h>
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <vector>
+
+// One contact resolved during a substep, recorded when PhysimConfig::RecordContacts is set.
+struct ContactEvent {
+    ecs::EntityID Id1{};
+    // The other circle, or the line's entity when LineContact is set.
+    ecs::EntityID Id2{};
+    // Unit vector pointing from the contact towards Id1, the direction Id1 was pushed.
+    sf::Vector2f Normal{};
+    float Penetration = 0.0f;
+    // Magnitude of the change in Id1's momentum.
+    float Impulse = 0.0f;
+    int Substep = 0;
+    bool LineContact = false;
+};
+
+// Running contact counts of one worker, for PhysimConfig::Diagnostics. Aligned so the workers' tallies never
+// share a cache line.
+struct alignas(64) ContactTally {
+    int Contacts = 0;
+    int LineContacts = 0;
+    float MaxPenetration = 0.0f;
+
+    void Add(const ContactEvent& event) {
+        (event.LineContact ? LineContacts : Contacts)++;
+        MaxPenetration = std::max(MaxPenetration, event.Penetration);
+    }
+};
+
+// Where a narrow phase reports the contacts it resolves. Each worker gets its own sink, Events and Tally are
+// null while recording and diagnostics are off so the check is the only cost.
+struct ContactSink {
+    TrackedVector<ContactEvent> *Events = nullptr;
+    ContactTally *Tally = nullptr;
+    int Substep = 0;
+
+    explicit operator bool() const {
+        return Events != nullptr || Tally != nullptr;
+    }
+
+    void Add(ContactEvent event) const {
+        if (Tally) {
+            Tally->Add(event);
+        }
+        if (Events) {
+            event.Substep = Substep;
+            Events->push_back(event);
+        }
+    }
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "PhysimCpp.h"
+#include "Transport.h"
+#include "ParticleRecord.h"
+#include <cstring>
+
+// Splits the world into slabs along x, slab i is simulated by its own process.
+struct SlabDecomposition {
+    WorldBoundrarys World;
+    int NrSlabs = 1;
+
+    [[nodiscard]] float SlabWidth() const {
+        return World.Size.x / NrSlabs;
+    }
+
+    [[nodiscard]] WorldBoundrarys GetSlab(int slab) const {
+        return {{World.Position.x + slab * SlabWidth(), World.Position.y}, {SlabWidth(), World.Size.y}};
+    }
+
+    [[nodiscard]] int SlabOf(float x) const {
+        return std::clamp(static_cast<int>((x - World.Position.x) / SlabWidth()), 0, NrSlabs - 1);
+    }
+};
+
+// Owns one slab. Every step particles that crossed a slab border migrate to the neighbour that owns them,
+// particles within ghostWidth of a border are copied to that neighbour as ghosts, and the slab is stepped with
+// the ghosts present so contacts across the border are seen from both sides. Ghosts are removed after the step.
+template <typename TEcs, typename TPhysim = PhysimCpp<TEcs>>
+class SlabWorker {
+public:
+    SlabWorker(TEcs& ecs, const SlabDecomposition& decomposition, int slab, Channel* lower, Channel* upper,
+               float ghostWidth, PhysimConfig config = {})
+    : ecs(ecs)
+    , decomposition(decomposition)
+    , slab(slab)
+    , lower(lower)
+    , upper(upper)
+    , ghostWidth(ghostWidth)
+    , physim(ecs, Expanded(decomposition.GetSlab(slab), ghostWidth), WithSynchronousQuery(config)) {
+    }
+
+    void Step(float dt) {
+        Migrate();
+        ExchangeGhosts();
+        physim.Run(dt);
+        for (const auto& id: ghosts) {
+            ecs.RemoveEntity(id);
+        }
+        ghosts.clear();
+    }
+
+    TPhysim& GetPhysim() {
+        return physim;
+    }
+
+private:
+    // Migration and ghosts change the entities every step, so the neighbour queries must be rebuilt in step.
+    static PhysimConfig WithSynchronousQuery(PhysimConfig config) {
+        config.AsyncQuery = false;
+        return config;
+    }
+
+    static WorldBoundrarys Expanded(const WorldBoundrarys& box, float width) {
+        return {{box.Position.x - width, box.Position.y}, {box.Size.x + 2 * width, box.Size.y}};
+    }
+
+    void Migrate() {
+        toLower.clear();
+        toUpper.clear();
+        std::vector<ecs::EntityID> leaving;
+        for (const auto& [circle, verlet, id]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID>()) {
+            if (verlet.Parked) {
+                continue;
+            }
+            const auto owner = decomposition.SlabOf(verlet.Position.x);
+            if (owner < slab && lower) {
+                toLower.push_back(MakeParticleRecord(circle, verlet));
+                leaving.push_back(id);
+            } else if (owner > slab && upper) {
+                toUpper.push_back(MakeParticleRecord(circle, verlet));
+                leaving.push_back(id);
+            }
+        }
+        for (const auto& id: leaving) {
+            ecs.RemoveEntity(id);
+        }
+        Exchange(false);
+    }
+
+    void ExchangeGhosts() {
+        toLower.clear();
+        toUpper.clear();
+        const auto box = decomposition.GetSlab(slab);
+        for (const auto& [circle, verlet]: ecs.template GetSystem<Circle, Verlet>()) {
+            if (verlet.Parked) {
+                continue;
+            }
+            if (lower && verlet.Position.x < box.Position.x + ghostWidth) {
+                toLower.push_back(MakeParticleRecord(circle, verlet));
+            }
+            if (upper && verlet.Position.x >= box.Position.x + box.Size.x - ghostWidth) {
+                toUpper.push_back(MakeParticleRecord(circle, verlet));
+            }
+        }
+        Exchange(true);
+    }
+
+    // The side with the lower slab index sends first, so two processes never block on a full socket buffer
+    // while both are trying to send.
+    void Exchange(bool asGhosts) {
+        if (lower) {
+            Receive(*lower, asGhosts);
+            Send(*lower, toLower);
+        }
+        if (upper) {
+            Send(*upper, toUpper);
+            Receive(*upper, asGhosts);
+        }
+    }
+
+    void Send(Channel& channel, const std::vector<ParticleRecord>& records) {
+        channel.Send(std::as_bytes(std::span(records)));
+    }
+
+    void Receive(Channel& channel, bool asGhosts) {
+        channel.Receive(buffer);
+        const auto count = buffer.size() / sizeof(ParticleRecord);
+        for (size_t i = 0; i < count; i++) {
+            ParticleRecord record;
+            std::memcpy(&record, buffer.data() + i * sizeof(ParticleRecord), sizeof(ParticleRecord));
+            auto id = BuildParticle(ecs, record);
+            if (asGhosts) {
+                ghosts.push_back(id);
+            }
+        }
+    }
+
+    TEcs& ecs;
+    const SlabDecomposition decomposition;
+    const int slab;
+    Channel* lower;
+    Channel* upper;
+    const float ghostWidth;
+    TPhysim physim;
+    std::vector<ecs::EntityID> ghosts;
+    std::vector<ParticleRecord> toLower;
+    std::vector<ParticleRecord> toUpper;
+    std::vector<std::byte> buffer;
+};
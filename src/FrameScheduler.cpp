@@ -0,0 +1,103 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+bool Intersects(const std::vector<std::type_index> &first, const std::vector<std::type_index> &second) {
+    return std::any_of(first.begin(), first.end(), [&](const auto &component) {
+        return std::find(second.begin(), second.end(), component) != second.end();
+    });
+}
+
+}
+
+FrameScheduler::FrameScheduler(ThreadPool &pool)
+        : pool(pool) {
+}
+
+size_t FrameScheduler::Add(Task task) {
+    tasks.push_back(std::move(task));
+    compiled = false;
+    return tasks.size() - 1;
+}
+
+void FrameScheduler::Clear() {
+    tasks.clear();
+    compiled = false;
+}
+
+size_t FrameScheduler::Size() const {
+    return tasks.size();
+}
+
+bool FrameScheduler::DependsOn(size_t task, size_t other) const {
+    if (other >= dependents.size()) {
+        return false;
+    }
+    const auto &waiting = dependents[other];
+    return std::find(waiting.begin(), waiting.end(), task) != waiting.end();
+}
+
+bool FrameScheduler::Conflicts(const Task &first, const Task &second) const {
+    if (first.Chunk != allChunks && second.Chunk != allChunks && first.Chunk != second.Chunk) {
+        return false;
+    }
+    return Intersects(first.Writes, second.Writes) || Intersects(first.Writes, second.Reads) ||
+           Intersects(first.Reads, second.Writes);
+}
+
+void FrameScheduler::Compile() {
+    dependents.assign(tasks.size(), {});
+    nrDependencies.assign(tasks.size(), 0);
+    for (size_t task = 0; task < tasks.size(); task++) {
+        for (size_t earlier = 0; earlier < task; earlier++) {
+            if (Conflicts(tasks[earlier], tasks[task])) {
+                dependents[earlier].push_back(task);
+                nrDependencies[task]++;
+            }
+        }
+    }
+    remaining.reserve(tasks.size());
+    ready.reserve(tasks.size());
+    compiled = true;
+}
+
+void FrameScheduler::Run() {
+    if (!compiled) {
+        Compile();
+    }
+    remaining = nrDependencies;
+    ready.clear();
+    finished = 0;
+    for (size_t task = 0; task < tasks.size(); task++) {
+        if (remaining[task] == 0) {
+            ready.push_back(task);
+        }
+    }
+    // Every worker takes one index and keeps picking up ready tasks until the whole graph is done.
+    const auto nrWorkers = std::min(pool.Size(), std::max<size_t>(tasks.size(), 1));
+    pool.ParallelFor(nrWorkers, [this](size_t, size_t) { Work(); });
+}
+
+void FrameScheduler::Work() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return !ready.empty() || finished == tasks.size(); });
+        if (ready.empty()) {
+            return;
+        }
+        const auto task = ready.back();
+        ready.pop_back();
+        lock.unlock();
+        tasks[task].Run();
+        lock.lock();
+        finished++;
+        for (const auto dependent: dependents[task]) {
+            if (--remaining[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+        wake.notify_all();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+template<typename... TComponents>
+std::vector<std::type_index> Components() {
+    return {std::type_index(typeid(TComponents))...};
+}
+
+// Runs a frame's systems as a task graph on a thread pool. Every task declares the components it reads and
+// writes, and depends on each earlier task that writes what it touches or touches what it writes. Results
+// match running the tasks one by one in the order they were added, while tasks with no such conflict run
+// concurrently. A task can be limited to one chunk of the entities, tasks on different chunks never conflict.
+class FrameScheduler {
+public:
+    static constexpr int allChunks = -1;
+
+    struct Task {
+        std::string Name{};
+        std::vector<std::type_index> Reads{};
+        std::vector<std::type_index> Writes{};
+        int Chunk = allChunks;
+        std::function<void()> Run{};
+    };
+
+    explicit FrameScheduler(ThreadPool &pool);
+
+    // Returns the task's index. The graph is rebuilt on the next Run.
+    size_t Add(Task task);
+
+    void Clear();
+
+    // Runs every task once and returns when all are done.
+    void Run();
+
+    [[nodiscard]] size_t Size() const;
+
+    // True when task waits directly on other.
+    [[nodiscard]] bool DependsOn(size_t task, size_t other) const;
+
+private:
+    void Compile();
+
+    bool Conflicts(const Task &first, const Task &second) const;
+
+    void Work();
+
+    ThreadPool &pool;
+    std::vector<Task> tasks;
+    std::vector<std::vector<size_t>> dependents;
+    std::vector<size_t> nrDependencies;
+    bool compiled = false;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<size_t> remaining;
+    std::vector<size_t> ready;
+    size_t finished = 0;
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "Components.h"
+#include "Util.h"
+#include "Arena.h"
+#include <array>
+#include <bit>
+#include <cmath>
+
+// Broadphase for scenes with mixed radii. Circles are bucketed into levels by size, level L uses cells twice
+// as large as level L - 1 and only holds circles that fit in one cell. A query only visits the levels that
+// have circles and whose bounds it reaches, with a search distance based on that level's largest radius,
+// so small circles never pay for the large ones.
+//
+// A circle's neighbours are the circles whose surface is closer than margin to its own surface.
+class HierarchicalGridBroadphase {
+public:
+    static constexpr int maxLevels = 16;
+    // Margin is measured between surfaces, see PhysimCpp::QueryMargin.
+    static constexpr bool surfaceMargin = true;
+
+    HierarchicalGridBroadphase() {
+        levels.reserve(maxLevels);
+        for (int i = 0; i < maxLevels; i++) {
+            levels.emplace_back(&arena);
+        }
+    }
+
+    // All level storage comes from an arena that is recycled on every build.
+    template <typename TEcs>
+    void Build(TEcs& ecs, const WorldBoundrarys& worldBoundrarys) {
+        for (auto& level: levels) {
+            level.Entries = std::pmr::vector<Entry>(&arena);
+            level.Sorted = std::pmr::vector<Entry>(&arena);
+            level.BucketStart = std::pmr::vector<uint32_t>(&arena);
+        }
+        arena.Reset();
+
+        float minRadius = std::numeric_limits<float>::max();
+        for (const auto& [circle, verlet]: ecs.template GetSystem<Circle, Verlet>()) {
+            if (worldBoundrarys.GetBox().contains(verlet.Position) && circle.Radius > 0) {
+                minRadius = std::min(minRadius, circle.Radius);
+            }
+        }
+        nrLevels = 0;
+        if (minRadius == std::numeric_limits<float>::max()) {
+            return;
+        }
+        baseCellSize = 2.0f * minRadius;
+        std::array<size_t, maxLevels> levelSizes{};
+        for (const auto& [circle, verlet]: ecs.template GetSystem<Circle, Verlet>()) {
+            if (worldBoundrarys.GetBox().contains(verlet.Position) && circle.Radius > 0) {
+                const auto levelIndex = LevelOf(circle.Radius);
+                levelSizes[levelIndex]++;
+                nrLevels = std::max(nrLevels, levelIndex + 1);
+            }
+        }
+        for (int i = 0; i < nrLevels; i++) {
+            levels[i].Entries.reserve(levelSizes[i]);
+        }
+        for (const auto& [circle, verlet, id]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID>()) {
+            if (worldBoundrarys.GetBox().contains(verlet.Position) && circle.Radius > 0) {
+                levels[LevelOf(circle.Radius)].Entries.push_back({verlet.Position, circle.Radius, id, 0});
+            }
+        }
+        for (int i = 0; i < nrLevels; i++) {
+            BuildLevel(levels[i], baseCellSize * static_cast<float>(1 << i));
+        }
+    }
+
+    void Query(const Circle& circle, const Verlet& verlet, float margin, octreeQuery& result,
+               std::pmr::memory_resource&) const {
+        result.clear();
+        const auto& position = verlet.Position;
+        for (int i = 0; i < nrLevels; i++) {
+            const auto& level = levels[i];
+            if (level.Entries.empty()) {
+                continue;
+            }
+            const float reach = circle.Radius + level.MaxRadius + margin;
+            if (position.x + reach < level.Min.x || position.x - reach > level.Max.x ||
+                position.y + reach < level.Min.y || position.y - reach > level.Max.y) {
+                continue;
+            }
+            // Clamped to the level's bounds, a large circle on a fine level would otherwise walk mostly empty cells.
+            const int minX = CellCoordinate(std::max(position.x - reach, level.Min.x), level.CellSize);
+            const int maxX = CellCoordinate(std::min(position.x + reach, level.Max.x), level.CellSize);
+            const int minY = CellCoordinate(std::max(position.y - reach, level.Min.y), level.CellSize);
+            const int maxY = CellCoordinate(std::min(position.y + reach, level.Max.y), level.CellSize);
+            for (int cy = minY; cy <= maxY; cy++) {
+                for (int cx = minX; cx <= maxX; cx++) {
+                    const auto cell = CellKey(cx, cy);
+                    const auto bucket = Bucket(cell, level);
+                    for (auto entry = level.BucketStart[bucket]; entry < level.BucketStart[bucket + 1]; entry++) {
+                        const auto& other = level.Entries[entry];
+                        if (other.Cell != cell) {
+                            continue;
+                        }
+                        const float distance = circle.Radius + other.Radius + margin;
+                        const auto delta = other.Position - position;
+                        if (delta.x * delta.x + delta.y * delta.y <= distance * distance) {
+                            result.push_back({other.Position, other.Id});
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Charges the level storage to account.
+    void TrackMemory(MemoryAccount* account) {
+        arena.TrackMemory(account);
+    }
+
+    [[nodiscard]] int GetNrLevels() const {
+        return nrLevels;
+    }
+
+    [[nodiscard]] size_t GetLevelSize(int level) const {
+        return levels[level].Entries.size();
+    }
+
+private:
+    struct Entry {
+        sf::Vector2f Position;
+        float Radius;
+        ecs::EntityID Id;
+        uint64_t Cell;
+    };
+
+    struct Level {
+        explicit Level(std::pmr::memory_resource* resource)
+        : Entries(resource)
+        , Sorted(resource)
+        , BucketStart(resource) {
+        }
+
+        float CellSize = 0.0f;
+        float MaxRadius = 0.0f;
+        sf::Vector2f Min;
+        sf::Vector2f Max;
+        uint32_t BucketMask = 0;
+        std::pmr::vector<Entry> Entries;
+        std::pmr::vector<Entry> Sorted;
+        std::pmr::vector<uint32_t> BucketStart;
+    };
+
+    int LevelOf(float radius) const {
+        const auto ratio = static_cast<unsigned>(std::ceil(2.0f * radius / baseCellSize));
+        return std::min(static_cast<int>(std::bit_width(std::max(ratio, 1u) - 1u)), maxLevels - 1);
+    }
+
+    static int CellCoordinate(float value, float cellSize) {
+        return static_cast<int>(std::floor(value / cellSize));
+    }
+
+    static uint64_t CellKey(int cx, int cy) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+    }
+
+    static uint32_t Bucket(uint64_t cell, const Level& level) {
+        return static_cast<uint32_t>((cell * 0x9E3779B97F4A7C15ull) >> 32) & level.BucketMask;
+    }
+
+    // Counting sort of the level's circles into a hashed table of cells.
+    static void BuildLevel(Level& level, float cellSize) {
+        level.CellSize = cellSize;
+        level.MaxRadius = 0.0f;
+        const auto nrBuckets = std::bit_ceil(std::max<uint32_t>(2 * level.Entries.size(), 1));
+        level.BucketMask = nrBuckets - 1;
+        level.BucketStart.assign(nrBuckets + 1, 0);
+        if (level.Entries.empty()) {
+            return;
+        }
+        level.Min = level.Max = level.Entries.front().Position;
+        for (auto& entry: level.Entries) {
+            entry.Cell = CellKey(CellCoordinate(entry.Position.x, cellSize), CellCoordinate(entry.Position.y, cellSize));
+            level.BucketStart[Bucket(entry.Cell, level) + 1]++;
+            level.MaxRadius = std::max(level.MaxRadius, entry.Radius);
+            level.Min = {std::min(level.Min.x, entry.Position.x), std::min(level.Min.y, entry.Position.y)};
+            level.Max = {std::max(level.Max.x, entry.Position.x), std::max(level.Max.y, entry.Position.y)};
+        }
+        for (uint32_t i = 0; i < nrBuckets; i++) {
+            level.BucketStart[i + 1] += level.BucketStart[i];
+        }
+        level.Sorted.resize(level.Entries.size());
+        for (const auto& entry: level.Entries) {
+            level.Sorted[level.BucketStart[Bucket(entry.Cell, level)]++] = entry;
+        }
+        for (uint32_t i = nrBuckets; i > 0; i--) {
+            level.BucketStart[i] = level.BucketStart[i - 1];
+        }
+        level.BucketStart[0] = 0;
+        std::swap(level.Entries, level.Sorted);
+    }
+
+    FrameArena arena;
+    std::vector<Level> levels;
+    int nrLevels = 0;
+    float baseCellSize = 1.0f;
+};
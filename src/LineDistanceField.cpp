@@ -0,0 +1,77 @@
+#include "LineDistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LineDistanceField::Bake(std::span<const Line> lines, const sf::FloatRect& area, float newCellSize, float newRange) {
+    cellSize = std::max(newCellSize, 1e-3f);
+    range = newRange;
+    origin = {area.left - range, area.top - range};
+    columns = static_cast<int>(std::ceil((area.width + 2 * range) / cellSize)) + 1;
+    rows = static_cast<int>(std::ceil((area.height + 2 * range) / cellSize)) + 1;
+    nodes.assign(static_cast<size_t>(columns) * rows, Node{.Distance=range});
+
+    for (uint32_t index = 0; index < lines.size(); index++) {
+        const auto& line = lines[index];
+        const auto segment = line.End - line.Start;
+        const float length2 = segment.x * segment.x + segment.y * segment.y;
+        const auto toNode = [&](float value, float start, int count) {
+            return std::clamp(static_cast<int>(std::floor((value - start) / cellSize)), 0, count - 1);
+        };
+        const int minX = toNode(std::min(line.Start.x, line.End.x) - range, origin.x, columns);
+        const int maxX = toNode(std::max(line.Start.x, line.End.x) + range, origin.x, columns) + 1;
+        const int minY = toNode(std::min(line.Start.y, line.End.y) - range, origin.y, rows);
+        const int maxY = toNode(std::max(line.Start.y, line.End.y) + range, origin.y, rows) + 1;
+        for (int y = minY; y <= std::min(maxY, rows - 1); y++) {
+            for (int x = minX; x <= std::min(maxX, columns - 1); x++) {
+                const sf::Vector2f position = origin + sf::Vector2f{static_cast<float>(x), static_cast<float>(y)} * cellSize;
+                const auto fromStart = position - line.Start;
+                const float t = length2 > 0 ? std::clamp((fromStart.x * segment.x + fromStart.y * segment.y) / length2, 0.0f, 1.0f) : 0.0f;
+                const auto offset = fromStart - segment * t;
+                const float distance = sf::getLength(offset);
+                auto& node = nodes[static_cast<size_t>(y) * columns + x];
+                if (distance >= std::abs(node.Distance)) {
+                    continue;
+                }
+                // The normal points into the wall, nodes on that side are behind it and their direction leads
+                // back out through the line. Past the ends both sides are free, so the sign only flips across the
+                // line itself and behind it, never in the open.
+                const bool behind = t > 0.0f && t < 1.0f && offset.x * line.Normal.x + offset.y * line.Normal.y > 0.0f;
+                node.Distance = behind ? -distance : distance;
+                node.Direction = distance > 0 ? (behind ? -offset : offset) / distance : -line.Normal;
+                node.Line = index;
+            }
+        }
+    }
+}
+
+LineDistanceField::Sample LineDistanceField::At(sf::Vector2f position) const {
+    const float fx = (position.x - origin.x) / cellSize;
+    const float fy = (position.y - origin.y) / cellSize;
+    if (nodes.empty() || fx < 0 || fy < 0 || fx > static_cast<float>(columns - 1) || fy > static_cast<float>(rows - 1)) {
+        return {.Distance=range};
+    }
+    const int x = std::min(static_cast<int>(fx), columns - 2);
+    const int y = std::min(static_cast<int>(fy), rows - 2);
+    const float tx = fx - static_cast<float>(x);
+    const float ty = fy - static_cast<float>(y);
+    const auto& n00 = nodes[static_cast<size_t>(y) * columns + x];
+    const auto& n10 = nodes[static_cast<size_t>(y) * columns + x + 1];
+    const auto& n01 = nodes[static_cast<size_t>(y + 1) * columns + x];
+    const auto& n11 = nodes[static_cast<size_t>(y + 1) * columns + x + 1];
+    const float w00 = (1 - tx) * (1 - ty);
+    const float w10 = tx * (1 - ty);
+    const float w01 = (1 - tx) * ty;
+    const float w11 = tx * ty;
+
+    Sample sample;
+    sample.Distance = n00.Distance * w00 + n10.Distance * w10 + n01.Distance * w01 + n11.Distance * w11;
+    const auto direction = n00.Direction * w00 + n10.Direction * w10 + n01.Direction * w01 + n11.Direction * w11;
+    const float length = sf::getLength(direction);
+    const auto nearest = std::min({&n00, &n10, &n01, &n11}, [](const Node* a, const Node* b) {
+        return a->Distance < b->Distance;
+    });
+    sample.Direction = length > 1e-6f ? direction / length : nearest->Direction;
+    sample.Line = nearest->Line;
+    return sample;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Memory.h"
+#include "Util.h"
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+// Signed distance to the nearest of a set of static lines, baked into a grid so a lookup costs the same however
+// many lines there are. Every grid node stores its distance to the nearest line, the direction in which that
+// distance grows and the index of that line, and a sample interpolates the four nodes around a position.
+//
+// A line's Normal points into the wall, the way the swept collision pushes circles out along -Normal, so the
+// distance is negative on that side, between the line's ends, and the direction leads back out through the
+// line. Only distances up to range are baked, a line is rasterized into the nodes within range of it and
+// everything further away reads as range.
+class LineDistanceField {
+public:
+    static constexpr uint32_t noLine = std::numeric_limits<uint32_t>::max();
+
+    struct Sample {
+        float Distance = 0.0f;
+        // Unit vector towards the free side of the nearest line, zero when no line is within range.
+        sf::Vector2f Direction{};
+        // Index into the baked lines, noLine when none is within range.
+        uint32_t Line = noLine;
+    };
+
+    // Covers area grown by range on every side, outside of it samples read as range.
+    void Bake(std::span<const Line> lines, const sf::FloatRect& area, float cellSize, float range);
+
+    [[nodiscard]] Sample At(sf::Vector2f position) const;
+
+    [[nodiscard]] float GetRange() const {
+        return range;
+    }
+
+    [[nodiscard]] float GetCellSize() const {
+        return cellSize;
+    }
+
+    [[nodiscard]] size_t GetNrNodes() const {
+        return nodes.size();
+    }
+
+    // Charges the nodes to account from the next Bake on.
+    void TrackMemory(MemoryAccount* account) {
+        nodes = TrackedVector<Node>(TrackingAllocator<Node>(account));
+    }
+
+    [[nodiscard]] size_t GetMemoryBytes() const {
+        return nodes.capacity() * sizeof(Node);
+    }
+
+private:
+    struct Node {
+        float Distance = 0.0f;
+        sf::Vector2f Direction{};
+        uint32_t Line = noLine;
+    };
+
+    sf::Vector2f origin;
+    int columns = 0;
+    int rows = 0;
+    float cellSize = 1.0f;
+    float range = 0.0f;
+    TrackedVector<Node> nodes;
+};
@@ -0,0 +1,33 @@
+#include "Memory.h"
+
+#include <iomanip>
+
+namespace {
+
+double Megabytes(size_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+}
+
+MemoryUsage GetUsage(const std::string& name, const MemoryAccount& account, bool sampled) {
+    return {.Name=name, .Live=account.GetLive(), .Peak=account.GetPeak(), .Allocations=account.GetAllocations(),
+            .FrameAllocations=account.GetFrameAllocations(), .Sampled=sampled};
+}
+
+void PrintMemoryReport(std::ostream& out, const MemoryReport& report) {
+    size_t live = 0;
+    for (const auto& usage: report) {
+        out << std::left << std::setw(16) << usage.Name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << Megabytes(usage.Live) << " MB live" << std::setw(10) << Megabytes(usage.Peak)
+            << " MB peak";
+        if (usage.Sampled) {
+            out << "  (sampled)\n";
+        } else {
+            out << std::setw(10) << usage.Allocations << " allocations" << std::setw(8) << usage.FrameAllocations
+                << " last frame\n";
+        }
+        live += usage.Live;
+    }
+    out << std::left << std::setw(16) << "total" << std::right << std::setw(10) << Megabytes(live) << " MB live\n";
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Bytes and allocations charged to one subsystem. Tracked memory is charged on every allocation, by a
+// TrackingAllocator or a container that takes an account. Memory owned by containers that can not take one is
+// sampled from their capacity when a report is taken, and has no allocation counts. Counters are atomic, an
+// account may be charged from any thread.
+class MemoryAccount {
+public:
+    void Allocate(size_t bytes) {
+        const auto now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        RaisePeak(now);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Deallocate(size_t bytes) {
+        live.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    void Sample(size_t bytes) {
+        live.store(bytes, std::memory_order_relaxed);
+        RaisePeak(bytes);
+    }
+
+    // Ends a frame, GetFrameAllocations then counts the allocations made since the previous call.
+    void StartFrame() {
+        const auto total = allocations.load(std::memory_order_relaxed);
+        frameAllocations = total - frameStart;
+        frameStart = total;
+    }
+
+    [[nodiscard]] size_t GetLive() const { return live.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] size_t GetPeak() const { return peak.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] size_t GetAllocations() const { return allocations.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] size_t GetFrameAllocations() const { return frameAllocations; }
+
+private:
+    void RaisePeak(size_t bytes) {
+        auto current = peak.load(std::memory_order_relaxed);
+        while (bytes > current && !peak.compare_exchange_weak(current, bytes, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::atomic<size_t> live = 0;
+    std::atomic<size_t> peak = 0;
+    std::atomic<size_t> allocations = 0;
+    size_t frameStart = 0;
+    size_t frameAllocations = 0;
+};
+
+// std::allocator that charges an account, or nothing when it has none. The account travels with the
+// container on copy, move and swap.
+template <typename T>
+class TrackingAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    TrackingAllocator() = default;
+
+    explicit TrackingAllocator(MemoryAccount* account)
+    : account(account) {
+    }
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U>& other)
+    : account(other.GetAccount()) {
+    }
+
+    T* allocate(size_t n) {
+        if (account) {
+            account->Allocate(n * sizeof(T));
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (account) {
+            account->Deallocate(n * sizeof(T));
+        }
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    [[nodiscard]] MemoryAccount* GetAccount() const {
+        return account;
+    }
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U>& other) const {
+        return account == other.GetAccount();
+    }
+
+private:
+    MemoryAccount* account = nullptr;
+};
+
+template <typename T>
+using TrackedVector = std::vector<T, TrackingAllocator<T>>;
+
+struct MemoryUsage {
+    std::string Name;
+    size_t Live = 0;
+    size_t Peak = 0;
+    // Zero for sampled memory.
+    size_t Allocations = 0;
+    size_t FrameAllocations = 0;
+    bool Sampled = false;
+};
+
+using MemoryReport = std::vector<MemoryUsage>;
+
+MemoryUsage GetUsage(const std::string& name, const MemoryAccount& account, bool sampled = false);
+
+// One line per subsystem with live and peak bytes, and allocations in total and in the last frame.
+void PrintMemoryReport(std::ostream& out, const MemoryReport& report);
@@ -0,0 +1,137 @@
+#include "Overlay.h"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+constexpr float pixelsPerSecond = 4000.0f;
+const sf::Color velocityColor{80, 160, 255};
+const sf::Color queryColor{255, 170, 40};
+const sf::Color solveColor{230, 60, 60};
+const sf::Color renderColor{120, 220, 120};
+
+void AddQuad(sf::VertexArray &array, sf::FloatRect rect, sf::Color color) {
+    array.append(sf::Vertex({rect.left, rect.top}, color));
+    array.append(sf::Vertex({rect.left + rect.width, rect.top}, color));
+    array.append(sf::Vertex({rect.left + rect.width, rect.top + rect.height}, color));
+    array.append(sf::Vertex({rect.left, rect.top + rect.height}, color));
+}
+
+// Blue for low values through red for the maximum.
+sf::Color HeatColor(float value) {
+    const auto red = static_cast<uint8_t>(255 * value);
+    return {red, 0, static_cast<uint8_t>(255 - red), static_cast<uint8_t>(60 + 120 * value)};
+}
+
+std::string Milliseconds(double seconds) {
+    return std::to_string(static_cast<int>(seconds * 1000.0)) + "." +
+           std::to_string(static_cast<int>(seconds * 10000.0) % 10) + " ms";
+}
+
+}
+
+void PerformanceOverlay::Push(const PhysimStats &stats, double renderTime) {
+    history[next] = {stats.VelocityTime, stats.QueryWaitTime, stats.SolveTime, renderTime};
+    next = (next + 1) % historySize;
+    last = stats;
+}
+
+void PerformanceOverlay::SetSnapshot(BroadphaseSnapshot newSnapshot) {
+    snapshot = std::move(newSnapshot);
+}
+
+void PerformanceOverlay::ToggleHeatMap() {
+    heatMap = heatMap == HeatMap::Density ? HeatMap::Neighbours : HeatMap::Density;
+}
+
+void PerformanceOverlay::Draw(sf::RenderWindow &window, const sf::Font &font) const {
+    // The heat map follows the camera, the timings stay in screen space.
+    const auto view = window.getView();
+    DrawHeatMap(window);
+    window.setView(window.getDefaultView());
+    DrawTimings(window, font);
+    window.setView(view);
+}
+
+void PerformanceOverlay::DrawHeatMap(sf::RenderWindow &window) const {
+    if (snapshot.Density.empty()) {
+        return;
+    }
+    std::vector<float> values(snapshot.Density.size(), 0.0f);
+    for (size_t i = 0; i < values.size(); i++) {
+        if (heatMap == HeatMap::Density) {
+            values[i] = static_cast<float>(snapshot.Density[i]);
+        } else if (snapshot.Density[i] > 0) {
+            values[i] = static_cast<float>(snapshot.Neighbours[i]) / static_cast<float>(snapshot.Density[i]);
+        }
+    }
+    const auto maxValue = *std::max_element(values.begin(), values.end());
+    if (maxValue <= 0.0f) {
+        return;
+    }
+
+    const sf::Vector2f cellSize{snapshot.Area.width / static_cast<float>(snapshot.Columns),
+                                snapshot.Area.height / static_cast<float>(snapshot.Rows)};
+    sf::VertexArray cells(sf::Quads);
+    for (int row = 0; row < snapshot.Rows; row++) {
+        for (int column = 0; column < snapshot.Columns; column++) {
+            const auto value = values[row * snapshot.Columns + column];
+            if (value <= 0.0f) {
+                continue;
+            }
+            AddQuad(cells, {snapshot.Area.left + column * cellSize.x, snapshot.Area.top + row * cellSize.y,
+                            cellSize.x, cellSize.y}, HeatColor(value / maxValue));
+        }
+    }
+    window.draw(cells);
+
+    sf::VertexArray outlines(sf::Lines);
+    const sf::Color outlineColor{255, 255, 255, 60};
+    for (const auto &cell: snapshot.Cells) {
+        const sf::Vector2f corners[] = {{cell.left,              cell.top},
+                                        {cell.left + cell.width, cell.top},
+                                        {cell.left + cell.width, cell.top + cell.height},
+                                        {cell.left,              cell.top + cell.height}};
+        for (int i = 0; i < 4; i++) {
+            outlines.append(sf::Vertex(corners[i], outlineColor));
+            outlines.append(sf::Vertex(corners[(i + 1) % 4], outlineColor));
+        }
+    }
+    window.draw(outlines);
+}
+
+void PerformanceOverlay::DrawTimings(sf::RenderWindow &window, const sf::Font &font) const {
+    const auto size = window.getView().getSize();
+    const sf::Vector2f origin{10.0f, size.y - 10.0f};
+    const float barWidth = 3.0f;
+
+    sf::VertexArray bars(sf::Quads);
+    AddQuad(bars, {origin.x - 2, origin.y - 102, historySize * barWidth + 4, 104}, sf::Color{0, 0, 0, 160});
+    for (size_t i = 0; i < historySize; i++) {
+        const auto &frame = history[(next + i) % historySize];
+        float y = origin.y;
+        const float x = origin.x + static_cast<float>(i) * barWidth;
+        for (const auto &[time, color]: {std::pair{frame.Velocity, velocityColor}, std::pair{frame.Query, queryColor},
+                                         std::pair{frame.Solve, solveColor}, std::pair{frame.Render, renderColor}}) {
+            const float height = std::min(static_cast<float>(time) * pixelsPerSecond, y - (origin.y - 100.0f));
+            AddQuad(bars, {x, y - height, barWidth - 1, height}, color);
+            y -= height;
+        }
+    }
+    window.draw(bars);
+
+    sf::Text legend;
+    legend.setFont(font);
+    legend.setCharacterSize(13);
+    legend.setPosition(origin.x + historySize * barWidth + 10, origin.y - 100);
+    legend.setString("velocity " + Milliseconds(last.VelocityTime) +
+                     "\nquery wait " + Milliseconds(last.QueryWaitTime) +
+                     "\nsolve " + Milliseconds(last.SolveTime) +
+                     "\nrender " + Milliseconds(history[(next + historySize - 1) % historySize].Render) +
+                     "\nrebuild " + Milliseconds(last.RebuildTime) + ", " +
+                     std::to_string(static_cast<int>(last.RebuildRate * 100)) + "% of frames" +
+                     "\nthreads " + std::to_string(static_cast<int>(last.ThreadUtilization * 100)) + "% busy" +
+                     "\nheat map: " + (heatMap == HeatMap::Density ? "density" : "neighbours"));
+    window.draw(legend);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "PhysimStats.h"
+#include <SFML/Graphics.hpp>
+#include <array>
+
+// Toggleable overlay drawn on top of the scene: a stacked bar graph of the recent per-phase timings, a heat map
+// of the last broadphase rebuild and the thread pool utilization.
+class PerformanceOverlay {
+public:
+    enum class HeatMap {
+        Density,
+        Neighbours
+    };
+
+    void Push(const PhysimStats &stats, double renderTime);
+
+    void SetSnapshot(BroadphaseSnapshot newSnapshot);
+
+    void ToggleHeatMap();
+
+    void Draw(sf::RenderWindow &window, const sf::Font &font) const;
+
+private:
+    static constexpr size_t historySize = 120;
+
+    struct Frame {
+        double Velocity = 0.0;
+        double Query = 0.0;
+        double Solve = 0.0;
+        double Render = 0.0;
+    };
+
+    void DrawHeatMap(sf::RenderWindow &window) const;
+
+    void DrawTimings(sf::RenderWindow &window, const sf::Font &font) const;
+
+    std::array<Frame, historySize> history{};
+    size_t next = 0;
+    PhysimStats last;
+    BroadphaseSnapshot snapshot;
+    HeatMap heatMap = HeatMap::Density;
+};
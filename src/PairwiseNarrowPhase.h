@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Components.h"
+#include "Contacts.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Resolves every overlapping pair once and applies the response to both circles symmetrically. All pairs of a
+// substep are evaluated against the same positions and velocities and their responses are gathered per circle
+// before anything moves, so the result does not depend on the order circles are visited in and the pairs can be
+// split over the thread pool. Every pair's impulse is applied in full to both circles, so momentum is conserved.
+// Pushes are averaged over a circle's contacts instead: summed, a circle squeezed from several sides at once
+// would be pushed apart once per neighbour, which overshoots in dense piles, and the substeps make up for the
+// slower convergence.
+//
+// A pair is solved from the lower entity id's side. Neighbour lists are only symmetric for equal radii unless the
+// broadphase measures its margin between surfaces, so the higher id solves an overlap its partner did not list.
+class PairwiseNarrowPhase {
+public:
+    // Pairs where neither circle is stepping, as told by isStepping(id), are left for a later substep.
+    template <typename TEcs, typename TStepping>
+    void SolvePairs(TEcs& ecs, ThreadPool& pool, int parts, const ContactSink* sinks, const TStepping& isStepping) {
+        if (!deltas || nrWorkers != pool.Size()) {
+            nrWorkers = pool.Size();
+            deltas = std::make_unique<std::vector<Delta>[]>(nrWorkers);
+        }
+        const int nrParts = std::max(parts, 1);
+        pool.ParallelFor(nrParts, [&](size_t part, size_t worker) {
+            auto& workerDeltas = deltas[worker];
+            for (const auto& [circle, verlet, id, query]: ecs.template GetSystemPart<Circle, Verlet, ecs::EntityID, octreeQuery>(part, nrParts)) {
+                const bool stepping = isStepping(id);
+                for (const auto& testPoint: query) {
+                    const auto& id2 = testPoint.Data;
+                    if (id2 == id || (!stepping && !isStepping(id2))) {
+                        continue;
+                    }
+                    const auto [verlet2, circle2, query2] = ecs.template GetSeveral<Verlet, Circle, octreeQuery>(id2);
+                    if (id2.GetId() > id.GetId()) {
+                        Collide(workerDeltas, sinks[worker], circle, verlet, id, circle2, verlet2, id2);
+                    } else if (Overlaps(circle, verlet, circle2, verlet2) &&
+                               std::none_of(query2.begin(), query2.end(), [&](const auto& other) { return other.Data == id; })) {
+                        Collide(workerDeltas, sinks[worker], circle2, verlet2, id2, circle, verlet, id);
+                    }
+                }
+            }
+        });
+        for (const auto& [verlet, id]: ecs.template GetSystem<Verlet, ecs::EntityID>()) {
+            Delta total;
+            for (size_t worker = 0; worker < nrWorkers; worker++) {
+                auto& workerDeltas = deltas[worker];
+                if (id.GetId() < workerDeltas.size()) {
+                    total.Add(workerDeltas[id.GetId()]);
+                    workerDeltas[id.GetId()] = {};
+                }
+            }
+            if (total.Contacts > 0) {
+                verlet.Position += total.Push / static_cast<float>(total.Contacts);
+                verlet.Velocity += total.Velocity;
+            }
+        }
+    }
+
+private:
+    struct Delta {
+        sf::Vector2f Push;
+        sf::Vector2f Velocity;
+        int Contacts = 0;
+
+        void Add(const Delta& other) {
+            Push += other.Push;
+            Velocity += other.Velocity;
+            Contacts += other.Contacts;
+        }
+    };
+
+    static Delta& At(std::vector<Delta>& workerDeltas, const ecs::EntityID& id) {
+        if (id.GetId() >= workerDeltas.size()) {
+            workerDeltas.resize(id.GetId() + 1);
+        }
+        return workerDeltas[id.GetId()];
+    }
+
+    static bool Overlaps(const Circle& circle1, const Verlet& verlet1, const Circle& circle2, const Verlet& verlet2) {
+        const auto offset = verlet1.Position - verlet2.Position;
+        const float reach = circle1.Radius + circle2.Radius;
+        return offset.x * offset.x + offset.y * offset.y < reach * reach;
+    }
+
+    // Each circle moves its mass share of the overlap apart, the heavier one less, and the closing velocity
+    // along the normal is reflected with the lower bounciness of the two.
+    static void Collide(std::vector<Delta>& workerDeltas, const ContactSink& sink,
+                        const Circle& circle1, const Verlet& verlet1, const ecs::EntityID& id1,
+                        const Circle& circle2, const Verlet& verlet2, const ecs::EntityID& id2) {
+        const auto offset = verlet1.Position - verlet2.Position;
+        const float distance = sf::getLength(offset);
+        const float penetration = circle1.Radius + circle2.Radius - distance;
+        if (penetration <= 0.0f) {
+            return;
+        }
+        const auto normal = distance > 0.0f ? offset / distance : sf::Vector2f{1.0f, 0.0f};
+        const float totalMass = verlet1.Mass + verlet2.Mass;
+        const auto relative = verlet1.Velocity - verlet2.Velocity;
+        const float closing = relative.x * normal.x + relative.y * normal.y;
+        float impulse = 0.0f;
+        if (closing < 0.0f) {
+            const float bounciness = std::min(verlet1.Bounciness, verlet2.Bounciness);
+            impulse = -(1.0f + bounciness) * closing / (1.0f / verlet1.Mass + 1.0f / verlet2.Mass);
+        }
+
+        auto& delta1 = At(workerDeltas, id1);
+        delta1.Push += normal * (penetration * verlet2.Mass / totalMass);
+        delta1.Velocity += normal * (impulse / verlet1.Mass);
+        delta1.Contacts++;
+        auto& delta2 = At(workerDeltas, id2);
+        delta2.Push -= normal * (penetration * verlet1.Mass / totalMass);
+        delta2.Velocity -= normal * (impulse / verlet2.Mass);
+        delta2.Contacts++;
+
+        if (sink) {
+            sink.Add({.Id1=id1, .Id2=id2, .Normal=normal, .Penetration=penetration, .Impulse=impulse});
+        }
+    }
+
+    size_t nrWorkers = 0;
+    std::unique_ptr<std::vector<Delta>[]> deltas;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Util.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Recycles the entities of circles that left the world instead of removing them. A released circle is parked
+// once, outside the world with a zero radius and Verlet::Parked set, so the systems skip it and it stays put until
+// its entity is handed out again by the next Acquire with new component values. Once the pool has grown to the
+// peak number of live circles, emitting and releasing make no structural changes to the ECS and no allocations.
+template <typename TEcs>
+class ParticlePool {
+public:
+    static constexpr float parkingDistance = 1000.0f;
+
+    ParticlePool(TEcs& ecs, const WorldBoundrarys& worldBoundrarys, uint32_t seed = std::random_device{}())
+    : ecs(ecs)
+    , parking(worldBoundrarys.Position - sf::Vector2f{parkingDistance, parkingDistance})
+    , random(seed) {
+    }
+
+    // Builds parked entities until count are free, so the next count acquires never touch the ECS structure.
+    void Reserve(size_t count) {
+        while (free.size() < count) {
+            Release(ecs.BuildEntity(Circle{.Radius=0.0f}, Verlet{}, octreeQuery{}));
+        }
+    }
+
+    ecs::EntityID Acquire(const Circle& circle, const Verlet& verlet) {
+        Reserve(1);
+        const auto id = free.back();
+        free.pop_back();
+        parked[id.GetId()] = 0;
+        auto [pooledCircle, pooledVerlet] = ecs.template GetSeveral<Circle, Verlet>(id);
+        pooledCircle = circle;
+        pooledVerlet = verlet;
+        return id;
+    }
+
+    // Parks the circle and frees its entity for the next Acquire. Any circle can be released, not only the
+    // ones acquired from the pool. Releasing a parked circle does nothing.
+    void Release(const ecs::EntityID& id) {
+        if (IsParked(id)) {
+            return;
+        }
+        if (id.GetId() >= parked.size()) {
+            parked.resize(id.GetId() + 1, 0);
+        }
+        parked[id.GetId()] = 1;
+        Park(id);
+        free.push_back(id);
+    }
+
+    [[nodiscard]] bool IsParked(const ecs::EntityID& id) const {
+        return id.GetId() < parked.size() && parked[id.GetId()];
+    }
+
+    [[nodiscard]] size_t GetNrFree() const {
+        return free.size();
+    }
+
+    // Spawns the circles every Emitter owes for dt.
+    void Emit(float dt) {
+        if constexpr (ecs::HasTypes<TEcs, Emitter>()) {
+            size_t due = 0;
+            for (const auto& [emitter]: ecs.template GetSystem<Emitter>()) {
+                emitter.Carry += emitter.Rate * dt;
+                emitter.Due = static_cast<int>(emitter.Carry);
+                emitter.Carry -= static_cast<float>(emitter.Due);
+                due += emitter.Due;
+            }
+            // Entities can not be built while the emitters are iterated, so the pool grows first.
+            Reserve(due);
+            for (const auto& [emitter]: ecs.template GetSystem<Emitter>()) {
+                for (; emitter.Due > 0; emitter.Due--) {
+                    Spawn(emitter);
+                }
+            }
+        }
+    }
+
+private:
+    void Spawn(const Emitter& emitter) {
+        const auto& region = emitter.Region;
+        const sf::Vector2f position{Uniform(region.left, region.left + region.width),
+                                    Uniform(region.top, region.top + region.height)};
+        const sf::Vector2f velocity{emitter.Velocity.x + Uniform(-emitter.Spread.x, emitter.Spread.x),
+                                    emitter.Velocity.y + Uniform(-emitter.Spread.y, emitter.Spread.y)};
+        Acquire(emitter.Particle, Verlet{.Position=position, .Acceleration={0, 0}, .Velocity=velocity,
+                                         .PreviousPosition=position});
+    }
+
+    float Uniform(float min, float max) {
+        return std::uniform_real_distribution<float>(min, max)(random);
+    }
+
+    void Park(const ecs::EntityID& id) {
+        auto [circle, verlet] = ecs.template GetSeveral<Circle, Verlet>(id);
+        circle.Radius = 0.0f;
+        verlet = Verlet{.Position=parking, .Acceleration={0, 0}, .Velocity={0, 0}, .PreviousPosition=parking,
+                        .Parked=true};
+    }
+
+    TEcs& ecs;
+    const sf::Vector2f parking;
+    std::mt19937 random;
+    std::vector<ecs::EntityID> free;
+    // Indexed by entity id.
+    std::vector<uint8_t> parked;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Components.h"
+#include <type_traits>
+
+// Everything needed to recreate a particle, on another process or after it was paged out.
+struct ParticleRecord {
+    sf::Vector2f Position;
+    sf::Vector2f Velocity;
+    sf::Vector2f PreviousPosition;
+    float Radius = 0.0f;
+    float Mass = 1.0f;
+    float Bounciness = 0.0f;
+    float Friction = 0.0f;
+    uint32_t Color = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<ParticleRecord>);
+
+inline ParticleRecord MakeParticleRecord(const Circle& circle, const Verlet& verlet) {
+    return {verlet.Position, verlet.Velocity, verlet.PreviousPosition, circle.Radius, verlet.Mass,
+            verlet.Bounciness, verlet.Friction, circle.Color.toInteger()};
+}
+
+template <typename TEcs>
+ecs::EntityID BuildParticle(TEcs& ecs, const ParticleRecord& record) {
+    return ecs.BuildEntity(
+            Circle{.Radius=record.Radius, .Color=sf::Color(record.Color)},
+            Verlet{.Position=record.Position, .Acceleration={0, 0}, .Velocity=record.Velocity,
+                   .PreviousPosition=record.PreviousPosition, .Mass=record.Mass,
+                   .Bounciness=record.Bounciness, .Friction=record.Friction},
+            octreeQuery{});
+}
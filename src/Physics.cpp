@@ -1,5 +1,9 @@
 #include "Physics.h"
 #include <SFMLMath.hpp>
+#include <algorithm>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
 
 namespace {
 
@@ -11,6 +15,123 @@ bool FloatLessThan(float a, float b) {
     return a < b and not FloatEqual(a, b);
 }
 
+// Lane wrappers used to write the segment kernel once for every instruction set.
+struct ScalarLanes {
+    static constexpr int Width = 1;
+    using Mask = bool;
+    float v;
+
+    static ScalarLanes Load(const float *p) { return {*p}; }
+    static ScalarLanes Min(ScalarLanes a, ScalarLanes b) { return {std::min(a.v, b.v)}; }
+    static ScalarLanes Max(ScalarLanes a, ScalarLanes b) { return {std::max(a.v, b.v)}; }
+    static Mask And(Mask a, Mask b) { return a && b; }
+    static Mask Or(Mask a, Mask b) { return a || b; }
+    static uint32_t Bits(Mask m) { return m ? 1u : 0u; }
+    friend ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return {a.v + b.v}; }
+    friend ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return {a.v - b.v}; }
+    friend ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return {a.v * b.v}; }
+    friend ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return {a.v / b.v}; }
+    friend Mask operator<(ScalarLanes a, ScalarLanes b) { return a.v < b.v; }
+    friend Mask operator<=(ScalarLanes a, ScalarLanes b) { return a.v <= b.v; }
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+struct SseLanes {
+    static constexpr int Width = 4;
+    using Mask = __m128;
+    __m128 v;
+
+    static SseLanes Load(const float *p) { return {_mm_loadu_ps(p)}; }
+    static SseLanes Min(SseLanes a, SseLanes b) { return {_mm_min_ps(a.v, b.v)}; }
+    static SseLanes Max(SseLanes a, SseLanes b) { return {_mm_max_ps(a.v, b.v)}; }
+    static Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+    static Mask Or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+    static uint32_t Bits(Mask m) { return static_cast<uint32_t>(_mm_movemask_ps(m)); }
+    friend SseLanes operator+(SseLanes a, SseLanes b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend SseLanes operator-(SseLanes a, SseLanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend SseLanes operator*(SseLanes a, SseLanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend SseLanes operator/(SseLanes a, SseLanes b) { return {_mm_div_ps(a.v, b.v)}; }
+    friend Mask operator<(SseLanes a, SseLanes b) { return _mm_cmplt_ps(a.v, b.v); }
+    friend Mask operator<=(SseLanes a, SseLanes b) { return _mm_cmple_ps(a.v, b.v); }
+};
+#endif
+
+#if defined(__AVX2__)
+struct AvxLanes {
+    static constexpr int Width = 8;
+    using Mask = __m256;
+    __m256 v;
+
+    static AvxLanes Load(const float *p) { return {_mm256_loadu_ps(p)}; }
+    static AvxLanes Min(AvxLanes a, AvxLanes b) { return {_mm256_min_ps(a.v, b.v)}; }
+    static AvxLanes Max(AvxLanes a, AvxLanes b) { return {_mm256_max_ps(a.v, b.v)}; }
+    static Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static Mask Or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+    static uint32_t Bits(Mask m) { return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+    friend AvxLanes operator+(AvxLanes a, AvxLanes b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend AvxLanes operator-(AvxLanes a, AvxLanes b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend AvxLanes operator*(AvxLanes a, AvxLanes b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend AvxLanes operator/(AvxLanes a, AvxLanes b) { return {_mm256_div_ps(a.v, b.v)}; }
+    friend Mask operator<(AvxLanes a, AvxLanes b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    friend Mask operator<=(AvxLanes a, AvxLanes b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+};
+#endif
+
+template<typename V>
+V Broadcast(float value) {
+    alignas(32) std::array<float, segmentPacketWidth> values;
+    values.fill(value);
+    return V::Load(values.data());
+}
+
+template<typename V>
+V PointSegmentDistanceSquared(V px, V py, V ax, V ay, V dx, V dy, V zero, V one, V tiny) {
+    auto length = V::Max(dx * dx + dy * dy, tiny);
+    auto t = V::Min(V::Max(((px - ax) * dx + (py - ay) * dy) / length, zero), one);
+    auto ex = px - ax - dx * t;
+    auto ey = py - ay - dy * t;
+    return ex * ex + ey * ey;
+}
+
+// Closest distance between the swept segment p0 -> p0 + d1 and each packet segment is either zero when they cross,
+// or the smallest of the four endpoint to segment distances. Parallel segments divide by zero and fail the crossing
+// test, which is what we want.
+template<typename V>
+uint32_t MovingCircleSegments(const sf::Vector2f &start, const sf::Vector2f &end, float radius,
+                              const SegmentPacket &packet, int offset) {
+    const auto zero = Broadcast<V>(0.0f);
+    const auto one = Broadcast<V>(1.0f);
+    const auto tiny = Broadcast<V>(std::numeric_limits<float>::min());
+    const auto p0x = Broadcast<V>(start.x);
+    const auto p0y = Broadcast<V>(start.y);
+    const auto p1x = Broadcast<V>(end.x);
+    const auto p1y = Broadcast<V>(end.y);
+    const auto d1x = p1x - p0x;
+    const auto d1y = p1y - p0y;
+
+    const auto ax = V::Load(packet.StartX.data() + offset);
+    const auto ay = V::Load(packet.StartY.data() + offset);
+    const auto bx = V::Load(packet.EndX.data() + offset);
+    const auto by = V::Load(packet.EndY.data() + offset);
+    const auto d2x = bx - ax;
+    const auto d2y = by - ay;
+
+    auto distance = V::Min(
+            V::Min(PointSegmentDistanceSquared(p0x, p0y, ax, ay, d2x, d2y, zero, one, tiny),
+                   PointSegmentDistanceSquared(p1x, p1y, ax, ay, d2x, d2y, zero, one, tiny)),
+            V::Min(PointSegmentDistanceSquared(ax, ay, p0x, p0y, d1x, d1y, zero, one, tiny),
+                   PointSegmentDistanceSquared(bx, by, p0x, p0y, d1x, d1y, zero, one, tiny)));
+
+    const auto denominator = d1x * d2y - d1y * d2x;
+    const auto wx = ax - p0x;
+    const auto wy = ay - p0y;
+    const auto s = (wx * d2y - wy * d2x) / denominator;
+    const auto u = (wx * d1y - wy * d1x) / denominator;
+    auto crossing = V::And(V::And(zero <= s, s <= one), V::And(zero <= u, u <= one));
+
+    return V::Bits(V::Or(distance < Broadcast<V>(radius * radius), crossing));
+}
+
 }
 
 const CollisionResult& Min(const CollisionResult& a, const CollisionResult& b) {
@@ -56,3 +177,35 @@ sf::Vector2f UpdateCircleVelocity(Verlet &A, Verlet &B) {
 
     return optimizedP * B.Mass * A.Bounciness * -1.0f;
 }
+
+void PackSegments(std::span<const Line> lines, TrackedVector<SegmentPacket> &packets) {
+    packets.clear();
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (i % segmentPacketWidth == 0) {
+            packets.emplace_back();
+        }
+        auto &packet = packets.back();
+        const auto lane = packet.Count++;
+        packet.StartX[lane] = lines[i].Start.x;
+        packet.StartY[lane] = lines[i].Start.y;
+        packet.EndX[lane] = lines[i].End.x;
+        packet.EndY[lane] = lines[i].End.y;
+    }
+}
+
+uint32_t IntersectMovingCircleSegments(float radius, const sf::Vector2f &start, const sf::Vector2f &end,
+                                       const SegmentPacket &packet) {
+    uint32_t hits = 0;
+#if defined(__AVX2__)
+    hits = MovingCircleSegments<AvxLanes>(start, end, radius, packet, 0);
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (int offset = 0; offset < segmentPacketWidth; offset += SseLanes::Width) {
+        hits |= MovingCircleSegments<SseLanes>(start, end, radius, packet, offset) << offset;
+    }
+#else
+    for (int offset = 0; offset < packet.Count; offset++) {
+        hits |= MovingCircleSegments<ScalarLanes>(start, end, radius, packet, offset) << offset;
+    }
+#endif
+    return hits & ((1u << packet.Count) - 1u);
+}
@@ -3,7 +3,12 @@
 //
 #pragma once
 
+#include "Memory.h"
 #include "Util.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
 
 enum class CollisionType {
     Circle,
@@ -30,3 +35,21 @@ std::optional<float> Overlapp(const sf::CircleShape &circle1, const sf::CircleSh
 bool IntersectMovingCircleLine(float radius, const Verlet &verlet, const Line &line);
 
 sf::Vector2f UpdateCircleVelocity(Verlet &A, Verlet &B);
+
+static constexpr int segmentPacketWidth = 8;
+
+// Line segments stored as structure of arrays so one swept circle can be tested against a whole packet at once.
+struct SegmentPacket {
+    alignas(32) std::array<float, segmentPacketWidth> StartX{};
+    alignas(32) std::array<float, segmentPacketWidth> StartY{};
+    alignas(32) std::array<float, segmentPacketWidth> EndX{};
+    alignas(32) std::array<float, segmentPacketWidth> EndY{};
+    int Count = 0;
+};
+
+void PackSegments(std::span<const Line> lines, TrackedVector<SegmentPacket> &packets);
+
+// Bit i is set when the circle swept from start to end is closer than radius to segment i of the packet,
+// same test as IntersectMovingCircleLine.
+uint32_t IntersectMovingCircleSegments(float radius, const sf::Vector2f &start, const sf::Vector2f &end,
+                                       const SegmentPacket &packet);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "PhysimCpp.h"
+#include "ThreadPool.h"
+#include <memory>
+
+// Steps many independent worlds on a shared thread pool, one world per task. Meant for parameter sweeps
+// where every world is small and throughput over all of them is what matters. Each world gets its own
+// PhysimConfig, so restitution, substeps and query settings can be swept side by side.
+template <typename TEcs, typename TPhysim = PhysimCpp<TEcs>>
+class PhysimBatch {
+public:
+    explicit PhysimBatch(ThreadPool& pool)
+    : pool(pool) {
+    }
+
+    // Parallelism comes from stepping worlds side by side, so each world queries synchronously in one part.
+    static PhysimConfig DefaultConfig() {
+        return PhysimConfig{.NrThreads=1, .QueryParts=1, .AsyncQuery=false};
+    }
+
+    size_t AddWorld(const WorldBoundrarys& worldBoundrarys, const PhysimConfig& config = DefaultConfig()) {
+        worlds.push_back(std::make_unique<World>(worldBoundrarys, config));
+        return worlds.size() - 1;
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return worlds.size();
+    }
+
+    TEcs& GetEcs(size_t world) {
+        return worlds[world]->Ecs;
+    }
+
+    TPhysim& GetPhysim(size_t world) {
+        return worlds[world]->Physim;
+    }
+
+    void Step(float dt, int steps = 1) {
+        Step(dt, steps, [](TEcs&, float) {});
+    }
+
+    // beforeRun(ecs, dt) is called for every world before each step, for example to apply gravity.
+    template <typename TCallback>
+    void Step(float dt, int steps, const TCallback& beforeRun) {
+        pool.ParallelFor(worlds.size(), [&](size_t i, size_t) {
+            auto& world = *worlds[i];
+            for (int step = 0; step < steps; step++) {
+                beforeRun(world.Ecs, dt);
+                world.Physim.Run(dt);
+            }
+        });
+    }
+
+private:
+    struct World {
+        World(const WorldBoundrarys& worldBoundrarys, const PhysimConfig& config)
+        : Physim(Ecs, worldBoundrarys, config) {
+        }
+
+        TEcs Ecs;
+        TPhysim Physim;
+    };
+
+    ThreadPool& pool;
+    std::vector<std::unique_ptr<World>> worlds;
+};
@@ -7,132 +7,727 @@
 #include "Components.h"
 #include "System.h"
 #include "Util.h"
-#include <iostream>
+#include "Physics.h"
+#include "PhysimPolicies.h"
+#include "PhysimStats.h"
+#include "ThreadPool.h"
+#include "Arena.h"
+#include "FrameScheduler.h"
+#include "LineDistanceField.h"
+#include "Memory.h"
+#include "StateExport.h"
+#include <bit>
+#include <span>
+#include <tuple>
 
-template <typename TEcs>
+// The broadphase, narrow phase and integrator are compile time policies so every combination gets its own
+// inlined hot loop, see PhysimPolicies.h for the interface each one implements.
+template <typename TEcs,
+          typename TBroadphase = OctreeBroadphase,
+          typename TNarrowPhase = AveragedNarrowPhase,
+          typename TIntegrator = VerletIntegrator>
 class PhysimCpp {
 public:
-    constexpr PhysimCpp(TEcs& ecs, const WorldBoundrarys& worldBoundrarys)
+    PhysimCpp(TEcs& ecs, const WorldBoundrarys& worldBoundrarys, const PhysimConfig& config = {})
     : ecs(ecs)
-    , worldBoundrarys(worldBoundrarys) {
+    , worldBoundrarys(worldBoundrarys)
+    , config(config)
+    , pool(std::max(config.NrThreads, 1))
+    , scratch(std::make_unique<FrameArena[]>(pool.Size()))
+    , contactBuffers(std::make_unique<TrackedVector<ContactEvent>[]>(pool.Size()))
+    , sinks(std::make_unique<ContactSink[]>(pool.Size()))
+    , tallies(std::make_unique<ContactTally[]>(pool.Size()))
+    , motion(pool.Size())
+    , queryTask([this]() { RebuildQuery(); }) {
+        if constexpr (requires { broadphase.TrackMemory(&broadphaseMemory); }) {
+            broadphase.TrackMemory(&broadphaseMemory);
+        }
+        for (size_t i = 0; i < pool.Size(); i++) {
+            scratch[i].TrackMemory(&scratchMemory);
+            contactBuffers[i] = TrackedVector<ContactEvent>(TrackingAllocator<ContactEvent>(&solverMemory));
+        }
+        lineField.TrackMemory(&solverMemory);
+    }
+
+    // The entities keep their lists, which must not charge the accounts of this instance any more.
+    ~PhysimCpp() {
+        queryTask.Wait();
+        if constexpr (ecs::HasTypes<TEcs, octreeQuery>()) {
+            for (const auto& [query]: ecs.template GetSystem<octreeQuery>()) {
+                query = octreeQuery{};
+            }
+        }
+    }
+
+    PhysimCpp(const PhysimCpp&) = delete;
+    PhysimCpp& operator=(const PhysimCpp&) = delete;
+
+    [[nodiscard]] const PhysimStats& GetStats() const {
+        return stats;
+    }
+
+    [[nodiscard]] const PhysimConfig& GetConfig() const {
+        return config;
+    }
+
+    // Takes effect from the next Run, except NrThreads, and AsyncQuery once the first query has been started.
+    void SetConfig(const PhysimConfig& newConfig) {
+        config = newConfig;
+    }
+
+    [[nodiscard]] const TBroadphase& GetBroadphase() const {
+        return broadphase;
+    }
+
+    // Copy of the snapshot taken at the last finished rebuild, empty unless CollectSnapshot is set.
+    [[nodiscard]] BroadphaseSnapshot GetBroadphaseSnapshot() const {
+        std::lock_guard lock(snapshotMutex);
+        return snapshot;
+    }
+
+    // Waits for a query rebuild in progress and has the next Run rebuild the neighbour lists before it solves.
+    // Call it before adding or removing circles between Runs, which a background rebuild still reads and whose
+    // ids the current lists still hold.
+    void InvalidateQuery() {
+        queryTask.Wait();
+        queryInvalid = true;
     }
 
     void Run(float dt) {
-        UpdateVelocity(dt);
-        UpdateQuery();
+        UpdateVelocity(dt, 0, 1);
+        QueryAndSolve(dt);
+    }
+
+    // Live and peak bytes per subsystem. The broadphase, the scratch arenas, the neighbour lists and the solver's
+    // buffers are tracked per allocation, with allocation counts for the last frame. The lists of circles added
+    // since the last rebuild are charged once a rebuild replaced them. Components are sampled from container
+    // capacities now.
+    [[nodiscard]] MemoryReport GetMemoryReport() {
+        componentMemory.Sample(ComponentBytes(ecs));
+        return {GetUsage("broadphase", broadphaseMemory), GetUsage("scratch", scratchMemory),
+                GetUsage("neighbour lists", neighbourMemory), GetUsage("components", componentMemory, true),
+                GetUsage("solver", solverMemory)};
+    }
+
+    // Publishes positions, radii and colors after every Run from now on, nullptr stops. The exporter has to
+    // outlive this instance or be reset first.
+    void SetExporter(StateExporter* newExporter) {
+        exporter = newExporter;
+    }
+
+    // Contacts resolved during the last Run, empty unless RecordContacts is set. Valid until the next Run.
+    [[nodiscard]] std::span<const ContactEvent> GetContacts() const {
+        return contacts;
+    }
+
+    // Adds the phases of Run to a scheduler instead: velocity integration as one task per chunk, then the
+    // query and the substeps. dt is read when the tasks run.
+    void AddTasks(FrameScheduler& scheduler, const float& dt, int nrChunks) {
+        for (int chunk = 0; chunk < nrChunks; chunk++) {
+            scheduler.Add({.Name="physim velocity", .Writes=Components<Verlet>(), .Chunk=chunk,
+                           .Run=[this, &dt, chunk, nrChunks]() { UpdateVelocity(dt, chunk, nrChunks); }});
+        }
+        scheduler.Add({.Name="physim query and solve", .Reads=Components<Circle, Line>(),
+                       .Writes=Components<Verlet, octreeQuery>(), .Run=[this, &dt]() { QueryAndSolve(dt); }});
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    // What a QueryBatch gets for each circle of its part.
+    using QueryItem = std::tuple<const Circle&, const Verlet&, octreeQuery&>;
+
+    static double SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
 
+    void Solve(float dt) {
         if constexpr (!ecs::HasTypes<TEcs, Circle, Verlet>()) {
             return;
         }
-        const float dtPart = dt / nrIterations;
-        for (int i = 0; i < nrIterations; i++) {
-            for (const auto [circle1, verlet1, id1, octreeQuery]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID, octreeQuery>()) {
-                CircleCircleCollision(circle1, verlet1, id1, octreeQuery, dtPart);
+        if constexpr (ecs::HasTypes<TEcs, Line>()) {
+            PackLines();
+        }
+        const int nrSubsteps = config.NrIterations;
+        const float dtPart = dt / nrSubsteps;
+        const int nrLevels = std::clamp(config.StepLevels, 1, std::countr_zero(static_cast<unsigned>(nrSubsteps)) + 1);
+        if (nrLevels > 1) {
+            AssignStepLevels(dtPart, nrLevels);
+        }
+        // Per particle narrow phases run on the calling thread, which records into the last worker's buffer.
+        for (size_t worker = 0; worker < pool.Size(); worker++) {
+            sinks[worker].Events = config.RecordContacts ? &contactBuffers[worker] : nullptr;
+            sinks[worker].Tally = config.Diagnostics ? &tallies[worker] : nullptr;
+        }
+        auto& sink = sinks[pool.Size() - 1];
+        auto levelOf = [&](const ecs::EntityID& id) {
+            return nrLevels > 1 ? stepLevels[id.GetId()] : 0;
+        };
+        int particleSteps = 0;
+        for (int i = 0; i < nrSubsteps; i++) {
+            for (size_t worker = 0; worker < pool.Size(); worker++) {
+                sinks[worker].Substep = i;
+            }
+            if constexpr (requires { narrowPhase.BeginSubstep(dtPart, i); }) {
+                narrowPhase.BeginSubstep(dtPart, i);
+            }
+            auto isStepping = [&](const ecs::EntityID& id) {
+                return i % (1 << levelOf(id)) == 0;
+            };
+            auto steps = [&](const Verlet& verlet, const ecs::EntityID& id) {
+                return !verlet.Parked && isStepping(id);
+            };
+            if constexpr (requires { narrowPhase.SolvePairs(ecs, pool, 1, sinks.get(), isStepping); }) {
+                // Pairwise narrow phases need every circle stepped before they look at any pair.
+                for (const auto [circle1, verlet1, id1]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID>()) {
+                    if (steps(verlet1, id1)) {
+                        particleSteps++;
+                        integrator.Step(verlet1, dtPart * static_cast<float>(1 << levelOf(id1)));
+                    }
+                }
+                narrowPhase.SolvePairs(ecs, pool, config.QueryParts, sinks.get(), isStepping);
                 if constexpr (ecs::HasTypes<TEcs, Line>()) {
-                    LineCircleCollision(verlet1, circle1);
+                    for (const auto [circle1, verlet1, id1]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID>()) {
+                        if (steps(verlet1, id1)) {
+                            LineCircleCollision(verlet1, circle1, id1, sink);
+                        }
+                    }
+                }
+            } else {
+                for (const auto [circle1, verlet1, id1, octreeQuery]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID, octreeQuery>()) {
+                    if (!steps(verlet1, id1)) {
+                        continue;
+                    }
+                    particleSteps++;
+                    integrator.Step(verlet1, dtPart * static_cast<float>(1 << levelOf(id1)));
+                    narrowPhase.Collide(ecs, circle1, verlet1, id1, octreeQuery, sink);
+                    if constexpr (ecs::HasTypes<TEcs, Line>()) {
+                        LineCircleCollision(verlet1, circle1, id1, sink);
+                    }
+                }
+            }
+            if constexpr (ecs::HasTypes<TEcs, octreeQuery>()) {
+                if (config.Skin > 0.0f && i + 1 < nrSubsteps) {
+                    RefreshVerletLists(dtPart * static_cast<float>(1 << (nrLevels - 1)));
                 }
             }
         }
+        stats.ParticleSteps = particleSteps;
+        MergeContacts();
     }
 
-private:
-    void CircleCircleCollision(auto& circle, auto& verlet, auto& id, auto& octreeQuery, float dt) {
-        verlet.PreviousPosition = verlet.Position;
-        verlet.Update(dt);
-        sf::Vector2f avgDirection;
-        sf::Vector2f avgVelocity;
-        bool collision = false;
-        for (const auto &testPoint: octreeQuery) {
-            const auto &id2 = testPoint.Data;
-            if (id == id2) {
-                continue;
+    // Picks the coarsest level on which a particle travels at most StepDistance of its radius per step, then
+    // keeps every particle within one level of its finest neighbour so contacts with fast particles are
+    // resolved on their steps.
+    void AssignStepLevels(float dtPart, int nrLevels) {
+        for (const auto& [circle, verlet, id]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID>()) {
+            const float travel = sf::getLength(verlet.Velocity) * dtPart;
+            const float allowed = circle.Radius * config.StepDistance;
+            int level = nrLevels - 1;
+            while (level > 0 && travel * static_cast<float>(1 << level) > allowed) {
+                level--;
             }
-
-            auto [verlet2, circle2] = ecs.template GetSeveral<Verlet, Circle>(id2);
-            auto overlapp = Overlapp(verlet.Position, verlet2.Position, circle.Radius, circle2.Radius);
-            if (!overlapp) {
-                continue;
+            if (id.GetId() >= stepLevels.size()) {
+                stepLevels.resize(id.GetId() + 1);
             }
-            collision = true;
-            auto newVelocity = UpdateCircleVelocity(verlet, verlet2);
-            avgVelocity += newVelocity;
-            verlet2.Velocity += sf::getNormalized(newVelocity) * sf::getLength(verlet2.Velocity) * -1.0f;
-            if (overlapp) {
-                auto direction = verlet.Position - verlet2.Position;
-                avgDirection += normalize(direction) * *overlapp * 0.5f;
+            stepLevels[id.GetId()] = static_cast<uint8_t>(level);
+        }
+        // A lowered level lowers the limit of its neighbours in turn, so passes repeat until nothing changes.
+        // Levels only go down, at most nrLevels passes change anything.
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (const auto& [id, octreeQuery]: ecs.template GetSystem<ecs::EntityID, octreeQuery>()) {
+                if (id.GetId() >= stepLevels.size()) {
+                    continue;
+                }
+                auto& level = stepLevels[id.GetId()];
+                for (const auto& neighbour: octreeQuery) {
+                    if (neighbour.Data.GetId() < stepLevels.size() && stepLevels[neighbour.Data.GetId()] + 1 < level) {
+                        level = static_cast<uint8_t>(stepLevels[neighbour.Data.GetId()] + 1);
+                        changed = true;
+                    }
+                }
             }
         }
-        if (collision) {
-            verlet.Position += avgDirection;
-            auto length = sf::getLength(verlet.Velocity);
-            verlet.Velocity += sf::getNormalized(avgVelocity) * length;
+    }
+
+    // Concatenates the per worker buffers, every worker only ever appends to its own.
+    void MergeContacts() {
+        contacts.clear();
+        for (size_t i = 0; i < pool.Size(); i++) {
+            contacts.insert(contacts.end(), contactBuffers[i].begin(), contactBuffers[i].end());
+            contactBuffers[i].clear();
         }
     }
 
-    void LineCircleCollision(auto& verlet, auto& circle) {
-        for (const auto& [line]: ecs.template GetSystem<Line>()) {
-            if (!IntersectMovingCircleLine(circle.Radius, verlet, line)) {
-                continue;
-            }
-            if (auto overlapp = Overlapp(line, verlet.Position, circle.Radius)) {
-                verlet.Position -= line.Normal * *overlapp * 1.0f;
+    void UpdateUtilization() {
+        const auto now = Clock::now();
+        const auto busy = pool.GetBusyTime();
+        if (lastRunEnd) {
+            const auto wall = std::chrono::duration<double>(now - *lastRunEnd).count() * pool.Size();
+            stats.ThreadUtilization = wall > 0 ? std::chrono::duration<double>(busy - lastBusyTime).count() / wall : 0.0;
+        }
+        lastRunEnd = now;
+        lastBusyTime = busy;
+    }
+
+    void LineCircleCollision(auto& verlet, auto& circle, const ecs::EntityID& id, const ContactSink& sink) {
+        if (config.LineFieldCellSize > 0.0f) {
+            LineFieldCollision(verlet, circle, id, sink);
+            return;
+        }
+        for (size_t packet = 0; packet < linePackets.size(); packet++) {
+            auto hits = IntersectMovingCircleSegments(circle.Radius, verlet.PreviousPosition, verlet.Position,
+                                                      linePackets[packet]);
+            while (hits) {
+                const auto lane = std::countr_zero(hits);
+                const auto& line = lines[packet * segmentPacketWidth + lane];
+                const auto velocityChange = sf::reflect(verlet.Velocity, line.Normal) * verlet.Bounciness;
+                verlet.Velocity -= velocityChange;
+                auto overlapp = Overlapp(line, verlet.Position, circle.Radius);
+                if (sink) {
+                    sink.Add({.Id1=id, .Id2=lineIds[packet * segmentPacketWidth + lane], .Normal=-line.Normal,
+                              .Penetration=overlapp.value_or(0.0f), .Impulse=verlet.Mass * sf::getLength(velocityChange),
+                              .LineContact=true});
+                }
+                if (overlapp) {
+                    verlet.Position -= line.Normal * *overlapp * 1.0f;
+                    // The circle moved, retest the rest of the packet from its new position.
+                    hits = IntersectMovingCircleSegments(circle.Radius, verlet.PreviousPosition, verlet.Position,
+                                                         linePackets[packet]) & ~((2u << lane) - 1u);
+                } else {
+                    hits &= hits - 1;
+                }
             }
-            verlet.Velocity -= sf::reflect(verlet.Velocity, line.Normal) * verlet.Bounciness;
         }
     }
 
-    void UpdateVelocity(float dt) {
+    // Pushes the circle out along the field's direction, which leads back to the free side also for a circle whose
+    // center has crossed the line, and removes the velocity into the nearest line.
+    void LineFieldCollision(auto& verlet, auto& circle, const ecs::EntityID& id, const ContactSink& sink) {
+        const auto sample = lineField.At(verlet.Position);
+        const float penetration = circle.Radius - sample.Distance;
+        if (penetration <= 0.0f || sample.Line == LineDistanceField::noLine) {
+            return;
+        }
+        const auto& normal = sample.Direction;
+        const float closing = verlet.Velocity.x * normal.x + verlet.Velocity.y * normal.y;
+        sf::Vector2f velocityChange;
+        if (closing < 0.0f) {
+            velocityChange = normal * (closing * (1.0f + verlet.Bounciness));
+            verlet.Velocity -= velocityChange;
+        }
+        verlet.Position += normal * penetration;
+        if (sink) {
+            sink.Add({.Id1=id, .Id2=lineIds[sample.Line], .Normal=-normal, .Penetration=penetration,
+                      .Impulse=verlet.Mass * sf::getLength(velocityChange), .LineContact=true});
+        }
+    }
+
+    void PackLines() {
+        lines.clear();
+        lineIds.clear();
+        for (const auto& [line, id]: ecs.template GetSystem<Line, ecs::EntityID>()) {
+            lines.push_back(line);
+            lineIds.push_back(id);
+        }
+        PackSegments(lines, linePackets);
+        if (config.LineFieldCellSize > 0.0f) {
+            UpdateLineField();
+        }
+    }
+
+    // Bakes again only when a line or the field settings changed since the last bake.
+    void UpdateLineField() {
+        const auto sameLine = [](const Line& a, const Line& b) {
+            return a.Start == b.Start && a.End == b.End && a.Normal == b.Normal;
+        };
+        if (stats.LineFieldBakes > 0 && lineField.GetCellSize() == config.LineFieldCellSize &&
+            lineField.GetRange() == config.LineFieldRange &&
+            std::equal(lines.begin(), lines.end(), bakedLines.begin(), bakedLines.end(), sameLine)) {
+            return;
+        }
+        lineField.Bake(lines, worldBoundrarys.GetBox(), config.LineFieldCellSize, config.LineFieldRange);
+        bakedLines = lines;
+        stats.LineFieldBakes++;
+    }
+
+    void UpdateVelocity(float dt, int chunk, int nrChunks) {
         if constexpr (!ecs::HasTypes<TEcs, Verlet>()) {
             return;
         }
-        for (const auto &[verlet]: ecs.template GetSystem<Verlet>()) {
-            verlet.Velocity += verlet.Acceleration * dt;
-            verlet.Acceleration = {0, 0};
+        const auto start = Clock::now();
+        for (const auto &[verlet]: ecs.template GetSystemPart<Verlet>(chunk, nrChunks)) {
+            if (!verlet.Parked) {
+                integrator.Accelerate(verlet, dt);
+            }
+        }
+        velocityTime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void QueryAndSolve(float dt) {
+        broadphaseMemory.StartFrame();
+        scratchMemory.StartFrame();
+        neighbourMemory.StartFrame();
+        solverMemory.StartFrame();
+        // Summed over the chunks when they ran as separate tasks.
+        stats.VelocityTime = static_cast<double>(velocityTime.exchange(0)) * 1e-9;
+        UpdateQuery(dt);
+        const auto solveStart = Clock::now();
+        Solve(dt);
+        stats.SolveTime = SecondsSince(solveStart);
+        // After the solve, which rebuilds too when pushes outrun the skin.
+        stats.RebuildRate = static_cast<double>(stats.QueryRebuilds) / std::max(frames, 1);
+        if (config.Diagnostics) {
+            SampleMotion();
+            ReduceDiagnostics();
+        }
+        if (exporter) {
+            Publish();
         }
+        UpdateUtilization();
     }
 
-    void UpdateQuery() {
+    // Sums energy and momentum after the last substep, one part per worker.
+    void SampleMotion() {
+        if constexpr (ecs::HasTypes<TEcs, Verlet>()) {
+            const size_t nrParts = motion.size();
+            pool.ParallelFor(nrParts, [&](size_t part, size_t) {
+                MotionPartial partial;
+                for (const auto& [verlet]: ecs.template GetSystemPart<Verlet>(part, nrParts)) {
+                    if (!verlet.Parked) {
+                        partial.Add(verlet);
+                    }
+                }
+                motion[part] = partial;
+            });
+        }
+    }
+
+    // Folds the per part and per worker partials in index order, so the sums do not depend on which thread
+    // finished first.
+    void ReduceDiagnostics() {
+        PhysimDiagnostics diagnostics;
+        for (auto& partial: motion) {
+            diagnostics.KineticEnergy += partial.KineticEnergy;
+            diagnostics.Momentum += partial.Momentum;
+            partial = {};
+        }
+        for (size_t i = 0; i < pool.Size(); i++) {
+            diagnostics.Contacts += tallies[i].Contacts;
+            diagnostics.LineContacts += tallies[i].LineContacts;
+            diagnostics.MaxPenetration = std::max(diagnostics.MaxPenetration, tallies[i].MaxPenetration);
+            tallies[i] = {};
+        }
+        stats.Diagnostics = diagnostics;
+    }
+
+    void Publish() {
+        if constexpr (ecs::HasTypes<TEcs, Circle, Verlet>()) {
+            const auto frame = exporter->BeginFrame();
+            uint32_t count = 0;
+            uint32_t total = 0;
+            for (const auto& [circle, verlet]: ecs.template GetSystem<Circle, Verlet>()) {
+                if (verlet.Parked) {
+                    continue;
+                }
+                if (count < frame.size()) {
+                    frame[count++] = {verlet.Position.x, verlet.Position.y, circle.Radius, circle.Color.toInteger()};
+                }
+                total++;
+            }
+            exporter->EndFrame(count, total);
+        }
+    }
+
+    void UpdateQuery(float dt) {
         if constexpr (!ecs::HasTypes<TEcs, Verlet, octreeQuery, Circle>()) {
             return;
         }
-        auto start = std::chrono::high_resolution_clock::now();
-        static bool first = true;
-        static int n = 0;
-        static std::future<void> future;
-        n++;
-        if (first || is_ready(future)) {
-            n = 0;
-            future = std::async(std::launch::async, [&](){
-                auto octree = MakeOctree(ecs, worldBoundrarys);
-                std::vector<std::future<void>> futures;
-                int maxParts = 2;
-                std::mutex mutex;
-                for (int i = 0; i < maxParts; i++) {
-                    futures.push_back(std::async(std::launch::async, [&, system=ecs.template GetSystemPart<Circle, Verlet, octreeQuery>(i, maxParts)]() {
-                        for (auto [circle, verlet, octreeQuery]: system) {
-                            auto queryResults = octree.Query(
-                                    Octree::Circle{{verlet.Position.x, verlet.Position.y}, circle.Radius + queryRadius});
-                            if (!queryResults.empty()) {
-                                std::lock_guard<std::mutex> lock(mutex);
-                                octreeQuery = queryResults;
-                            }
-                        }
-                    }));
+        auto start = Clock::now();
+        stats.FramesSinceQuery++;
+        frames++;
+        if (queryInvalid) {
+            queryInvalid = false;
+            StartRebuild();
+            RebuildQuery();
+            SwapInLists();
+            if (config.Skin > 0.0f) {
+                SetAnchors();
+            }
+        } else if (config.Skin > 0.0f) {
+            if (NeedsVerletRebuild(dt)) {
+                StartRebuild();
+                RebuildQuery();
+                SwapInLists();
+                SetAnchors();
+            }
+        } else if (!config.AsyncQuery && !asyncStarted) {
+            StartRebuild();
+            RebuildQuery();
+            SwapInLists();
+        } else {
+            // The lists of a finished background rebuild replace the entities' lists here, on the calling thread,
+            // so the solver never walks a list that is being written.
+            if (listsPending && !queryTask.IsRunning()) {
+                SwapInLists();
+                listsPending = false;
+            }
+            if (!queryTask.IsRunning()) {
+                StartRebuild();
+                queryTask.Start();
+                listsPending = true;
+            }
+            if (!asyncStarted) {
+                queryTask.Wait();
+                SwapInLists();
+                listsPending = false;
+                asyncStarted = true;
+            }
+        }
+        stats.QueryWaitTime = SecondsSince(start);
+        stats.RebuildTime = lastRebuildTime;
+    }
+
+    // Runs on the calling thread while no rebuild is in progress. Circles added after this get an empty list
+    // from the rebuild.
+    void StartRebuild() {
+        stats.FramesSinceQuery = 0;
+        stats.QueryRebuilds++;
+        listsPending = false;
+        queryConfig = config;
+        queryConfig.QueryRadius = QueryMargin();
+        // Lists swapped in from entities that were built with an untracked list are replaced once.
+        const octreeQuery tracked{octreeQuery::allocator_type(&neighbourMemory)};
+        for (auto& list: pendingLists) {
+            if (list.get_allocator() == tracked.get_allocator()) {
+                list.clear();
+            } else {
+                list = tracked;
+            }
+        }
+        for (const auto& [id, query]: ecs.template GetSystem<ecs::EntityID, octreeQuery>()) {
+            if (id.GetId() >= pendingLists.size()) {
+                pendingLists.resize(id.GetId() + 1, tracked);
+            }
+        }
+    }
+
+    // Swaps the lists of the last finished rebuild into the entities, the entities' old lists become the buffers
+    // of the next rebuild.
+    void SwapInLists() {
+        for (const auto& [id, query]: ecs.template GetSystem<ecs::EntityID, octreeQuery>()) {
+            if (id.GetId() < pendingLists.size()) {
+                std::swap(query, pendingLists[id.GetId()]);
+            }
+        }
+    }
+
+    // The lists stay valid while no two circles have closed in by more than the skin, which holds as long as
+    // none of them moved more than half of it. Every substep clamps the speed to Verlet::maxSpeed, so the
+    // distance the coming frame can add is counted up front.
+    bool NeedsVerletRebuild(float dt) {
+        // A background rebuild started before the skin was enabled still writes the lists.
+        queryTask.Wait();
+        const auto displacement = MeasureDisplacement();
+        return !displacement || anchorSkin != config.Skin || *displacement + Verlet::maxSpeed * dt > config.Skin * 0.5f;
+    }
+
+    // Overlap and line pushes are not bounded by the speed, so after every substep the displacement is measured
+    // again and the lists are rebuilt before a substep that could step past them. step is the longest step the
+    // next substep takes.
+    void RefreshVerletLists(float step) {
+        const auto displacement = MeasureDisplacement();
+        if (!displacement || *displacement + Verlet::maxSpeed * step > config.Skin * 0.5f) {
+            StartRebuild();
+            RebuildQuery();
+            SwapInLists();
+            SetAnchors();
+        }
+    }
+
+    // Largest distance a circle moved from its anchor, nothing when circles were added or removed since.
+    std::optional<float> MeasureDisplacement() {
+        float maxDisplacement = 0.0f;
+        size_t count = 0;
+        bool unknown = false;
+        for (const auto& [verlet, id]: ecs.template GetSystem<Verlet, ecs::EntityID>()) {
+            count++;
+            const auto index = id.GetId();
+            if (index >= anchors.size() || !anchors[index]) {
+                unknown = true;
+                continue;
+            }
+            maxDisplacement = std::max(maxDisplacement, sf::getLength(verlet.Position - *anchors[index]));
+        }
+        stats.MaxDisplacement = maxDisplacement;
+        if (unknown || count != anchoredCount) {
+            return std::nullopt;
+        }
+        return maxDisplacement;
+    }
+
+    void SetAnchors() {
+        for (auto& anchor: anchors) {
+            anchor.reset();
+        }
+        anchoredCount = 0;
+        anchorSkin = config.Skin;
+        for (const auto& [verlet, id]: ecs.template GetSystem<Verlet, ecs::EntityID>()) {
+            const auto index = id.GetId();
+            if (index >= anchors.size()) {
+                anchors.resize(index + 1);
+            }
+            anchors[index] = verlet.Position;
+            anchoredCount++;
+        }
+        stats.MaxDisplacement = 0.0f;
+    }
+
+    // Margin handed to the broadphase. With a skin every pair that can touch before the next rebuild has to be
+    // listed, broadphases that measure the margin from the circle's center instead of between surfaces also
+    // need room for the largest neighbour.
+    float QueryMargin() {
+        if (config.Skin <= 0.0f) {
+            return config.QueryRadius;
+        }
+        if constexpr (requires { TBroadphase::surfaceMargin; }) {
+            return config.Skin;
+        }
+        float maxRadius = 0.0f;
+        for (const auto& [circle]: ecs.template GetSystem<Circle>()) {
+            maxRadius = std::max(maxRadius, circle.Radius);
+        }
+        return maxRadius + config.Skin;
+    }
+
+    // Runs on the caller in synchronous mode, otherwise on queryTask. Writes only pendingLists, never the lists
+    // the solver reads. Either way nothing here allocates once the arenas and neighbour lists have grown to their
+    // steady state size.
+    void RebuildQuery() {
+        const auto start = Clock::now();
+        if constexpr (requires { broadphase.SetLeafSize(queryConfig.LeafSize); }) {
+            broadphase.SetLeafSize(queryConfig.LeafSize);
+        }
+        if constexpr (requires { broadphase.Build(ecs, worldBoundrarys, &pool); }) {
+            broadphase.Build(ecs, worldBoundrarys, &pool);
+        } else {
+            broadphase.Build(ecs, worldBoundrarys);
+        }
+        for (size_t i = 0; i < pool.Size(); i++) {
+            scratch[i].Reset();
+        }
+        const int maxParts = std::max(queryConfig.QueryParts, 1);
+        pool.ParallelFor(maxParts, [&](size_t i, size_t worker) {
+            auto part = ecs.template GetSystemPart<Circle, Verlet, ecs::EntityID>(i, maxParts);
+            if constexpr (requires(std::pmr::vector<QueryItem>& items) {
+                broadphase.QueryBatch(items, queryConfig.QueryRadius, scratch[worker]);
+            }) {
+                std::pmr::vector<QueryItem> items(&scratch[worker]);
+                for (const auto& [circle, verlet, id]: part) {
+                    if (!verlet.Parked && id.GetId() < pendingLists.size()) {
+                        items.emplace_back(circle, verlet, pendingLists[id.GetId()]);
+                    }
                 }
-                for (auto& future: futures) {
-                    future.wait();
+                broadphase.QueryBatch(items, queryConfig.QueryRadius, scratch[worker]);
+            } else {
+                for (const auto& [circle, verlet, id]: part) {
+                    if (!verlet.Parked && id.GetId() < pendingLists.size()) {
+                        broadphase.Query(circle, verlet, queryConfig.QueryRadius, pendingLists[id.GetId()],
+                                         scratch[worker]);
+                    }
                 }
-            });
+            }
+        });
+        if (queryConfig.CollectSnapshot) {
+            TakeSnapshot();
         }
-        if (first) {
-            future.wait();
-            first = false;
+        lastRebuildTime = SecondsSince(start);
+    }
+
+    void TakeSnapshot() {
+        constexpr float heatMapCellSize = 20.0f;
+        auto& pending = pendingSnapshot;
+        pending.Area = worldBoundrarys.GetBox();
+        pending.Columns = std::max(1, static_cast<int>(std::ceil(worldBoundrarys.Size.x / heatMapCellSize)));
+        pending.Rows = std::max(1, static_cast<int>(std::ceil(worldBoundrarys.Size.y / heatMapCellSize)));
+        pending.Density.assign(pending.Columns * pending.Rows, 0);
+        pending.Neighbours.assign(pending.Columns * pending.Rows, 0);
+        for (const auto& [verlet, id]: ecs.template GetSystem<Verlet, ecs::EntityID>()) {
+            if (!pending.Area.contains(verlet.Position) || id.GetId() >= pendingLists.size()) {
+                continue;
+            }
+            const auto& octreeQuery = pendingLists[id.GetId()];
+            const auto column = std::min(pending.Columns - 1, static_cast<int>((verlet.Position.x - pending.Area.left) / heatMapCellSize));
+            const auto row = std::min(pending.Rows - 1, static_cast<int>((verlet.Position.y - pending.Area.top) / heatMapCellSize));
+            pending.Density[row * pending.Columns + column]++;
+            pending.Neighbours[row * pending.Columns + column] += octreeQuery.size();
         }
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> diff = end-start;
-        std::cout << "Time spent waiting: " << diff.count() << " seconds" << std::endl;
-        std::cout << "Iterations: " << n << std::endl;
+        pending.Cells.clear();
+        if constexpr (requires { broadphase.GetCells(pending.Cells); }) {
+            broadphase.GetCells(pending.Cells);
+        }
+        std::lock_guard lock(snapshotMutex);
+        std::swap(snapshot, pendingSnapshot);
     }
+
     TEcs& ecs;
     const WorldBoundrarys worldBoundrarys;
+    PhysimConfig config;
+    // Declared before everything that charges them.
+    MemoryAccount broadphaseMemory;
+    MemoryAccount scratchMemory;
+    MemoryAccount neighbourMemory;
+    MemoryAccount componentMemory;
+    MemoryAccount solverMemory;
+    TBroadphase broadphase;
+    TNarrowPhase narrowPhase;
+    TIntegrator integrator;
+    bool asyncStarted = false;
+    // A background rebuild was started and its lists are not swapped in yet.
+    bool listsPending = false;
+    bool queryInvalid = false;
+    int frames = 0;
+    // Positions at the last Verlet list build, indexed by entity id.
+    TrackedVector<std::optional<sf::Vector2f>> anchors{TrackingAllocator<std::optional<sf::Vector2f>>(&solverMemory)};
+    size_t anchoredCount = 0;
+    float anchorSkin = 0.0f;
+    PhysimConfig queryConfig;
+    PhysimStats stats;
+    std::atomic<double> lastRebuildTime = 0.0;
+    std::atomic<int64_t> velocityTime = 0;
+    std::optional<Clock::time_point> lastRunEnd;
+    std::chrono::nanoseconds lastBusyTime{0};
+    BroadphaseSnapshot snapshot;
+    BroadphaseSnapshot pendingSnapshot;
+    mutable std::mutex snapshotMutex;
+    TrackedVector<Line> lines{TrackingAllocator<Line>(&solverMemory)};
+    TrackedVector<ecs::EntityID> lineIds{TrackingAllocator<ecs::EntityID>(&solverMemory)};
+    // Lists written by the rebuild, indexed by entity id, see SwapInLists.
+    TrackedVector<octreeQuery> pendingLists{TrackingAllocator<octreeQuery>(&neighbourMemory)};
+    // Step level of every circle for the current Run, indexed by entity id.
+    TrackedVector<uint8_t> stepLevels{TrackingAllocator<uint8_t>(&solverMemory)};
+    TrackedVector<SegmentPacket> linePackets{TrackingAllocator<SegmentPacket>(&solverMemory)};
+    LineDistanceField lineField;
+    TrackedVector<Line> bakedLines{TrackingAllocator<Line>(&solverMemory)};
+    ThreadPool pool;
+    std::unique_ptr<FrameArena[]> scratch;
+    std::unique_ptr<TrackedVector<ContactEvent>[]> contactBuffers;
+    std::unique_ptr<ContactSink[]> sinks;
+    std::unique_ptr<ContactTally[]> tallies;
+    // Energy and momentum per part, each written once by the worker that sums the part.
+    struct MotionPartial {
+        double KineticEnergy = 0.0;
+        sf::Vector2<double> Momentum{};
+
+        void Add(const Verlet& verlet) {
+            const sf::Vector2<double> velocity{verlet.Velocity};
+            KineticEnergy += 0.5 * verlet.Mass * (velocity.x * velocity.x + velocity.y * velocity.y);
+            Momentum += velocity * static_cast<double>(verlet.Mass);
+        }
+    };
+    std::vector<MotionPartial> motion;
+    TrackedVector<ContactEvent> contacts{TrackingAllocator<ContactEvent>(&solverMemory)};
+    StateExporter* exporter = nullptr;
+    // Declared last so it is destroyed first, a pending rebuild still uses the members above.
+    BackgroundTask queryTask;
 };
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Components.h"
+#include "Contacts.h"
+#include "Physics.h"
+#include "Quadtree.h"
+#include "Util.h"
+#include <iterator>
+#include <memory_resource>
+
+// Runtime tuning of a PhysimCpp instance, the defaults match the demo scene.
+struct PhysimConfig {
+    // Extra distance added to each circle's radius when collecting its neighbours.
+    float QueryRadius = queryRadius;
+    int NrIterations = nrIterations;
+    // Threads used by the instance including the calling one, fixed at construction.
+    int NrThreads = 2;
+    // Number of parallel parts the neighbour queries are split into.
+    int QueryParts = 2;
+    // Rebuild neighbour queries on a background thread while stepping on the previous result. The new lists are
+    // swapped in at the start of the first Run after the rebuild has finished.
+    bool AsyncQuery = true;
+    // Fill a BroadphaseSnapshot on every rebuild, for the performance overlay.
+    bool CollectSnapshot = false;
+    // Record every resolved contact, see PhysimCpp::GetContacts.
+    bool RecordContacts = false;
+    // Sum energy and momentum and count contacts during Run, see PhysimStats::Diagnostics.
+    bool Diagnostics = false;
+    // Power of two step levels. Above one, a particle on level k only steps every 2^k substeps, with a 2^k
+    // times longer step, and all levels line up at the end of each Run. Limited so 2^(levels - 1) divides
+    // NrIterations.
+    int StepLevels = 1;
+    // Share of its radius a particle may travel per step on its level, faster particles move to finer levels.
+    float StepDistance = 0.25f;
+    // Verlet list skin. When positive the neighbour lists are built synchronously with enough extra reach to
+    // stay valid until some circle has moved half the skin, and are reused until then. Replaces QueryRadius
+    // and AsyncQuery.
+    float Skin = 0.0f;
+    // When positive, lines are baked into a distance field with this cell size whenever they change, and
+    // circles collide with them through one lookup at their new position instead of a swept test against every
+    // line. Circles larger than LineFieldRange are not caught by the field.
+    float LineFieldCellSize = 0.0f;
+    float LineFieldRange = 4.0f * circleRadius;
+    // Items per leaf for broadphases built on a Quadtree.
+    uint32_t LeafSize = Quadtree<ecs::EntityID>::defaultLeafSize;
+};
+
+// Broadphase policies are built once per query rebuild, then queried concurrently for every circle. Query gets
+// the calling worker's scratch arena, which is reset at the start of every rebuild, and a list owned by the
+// rebuild rather than the entity's own. A broadphase may also implement QueryBatch(circles, margin, scratch),
+// circles being (Circle, Verlet, octreeQuery) tuples, to answer a whole part of the circles at once, may take
+// the instance's thread pool as a third argument to Build, and may implement SetLeafSize(PhysimConfig::LeafSize)
+// and TrackMemory(account) to have their storage show up in PhysimCpp::GetMemoryReport.
+struct OctreeBroadphase {
+    template <typename TEcs>
+    void Build(TEcs& ecs, const WorldBoundrarys& worldBoundrarys, ThreadPool* pool = nullptr) {
+        tree.Clear();
+        for (const auto& [verlet, id]: ecs.template GetSystem<Verlet, ecs::EntityID>()) {
+            if (worldBoundrarys.GetBox().contains(verlet.Position)) {
+                tree.Add({verlet.Position, id});
+            }
+        }
+        tree.Build(worldBoundrarys.GetBox(), pool);
+    }
+
+    void Query(const Circle& circle, const Verlet& verlet, float margin, octreeQuery& result,
+               std::pmr::memory_resource&) const {
+        result.clear();
+        tree.QueryInto({verlet.Position, circle.Radius + margin}, std::back_inserter(result));
+    }
+
+    // Answers a whole part of the circles in one walk of the tree.
+    template <typename TRange>
+    void QueryBatch(TRange&& circles, float margin, std::pmr::memory_resource& scratch) const {
+        std::pmr::vector<QuadtreeQuery> queries(&scratch);
+        std::pmr::vector<octreeQuery*> results(&scratch);
+        for (auto [circle, verlet, result]: circles) {
+            result.clear();
+            queries.push_back({verlet.Position, circle.Radius + margin});
+            results.push_back(&result);
+        }
+        tree.QueryBatch(queries, [&](size_t query, const auto& item) { results[query]->push_back(item); }, scratch);
+    }
+
+    void SetLeafSize(uint32_t size) {
+        tree.SetLeafSize(size);
+    }
+
+    void TrackMemory(MemoryAccount* account) {
+        tree.TrackMemory(account);
+    }
+
+    void GetCells(std::vector<sf::FloatRect>& cells) const {
+        tree.ForEachLeaf([&](const sf::Vector2f& min, const sf::Vector2f& max) {
+            cells.emplace_back(min, max - min);
+        });
+    }
+
+    Quadtree<ecs::EntityID> tree;
+};
+
+// Resolves one circle against its neighbours by averaging the push and velocity change of every overlap.
+// Narrow phases report what they resolve to contacts when it is set, and may implement
+// BeginSubstep(dt, substep) to be told when each substep starts. A narrow phase that implements
+// SolvePairs(ecs, pool, parts, sinks, isStepping) instead of Collide resolves all pairs at once after every
+// circle is stepped, see PairwiseNarrowPhase.
+struct AveragedNarrowPhase {
+    template <typename TEcs>
+    void Collide(TEcs& ecs, const Circle& circle, Verlet& verlet, const ecs::EntityID& id, const octreeQuery& query,
+                 const ContactSink& contacts) {
+        sf::Vector2f avgDirection;
+        sf::Vector2f avgVelocity;
+        bool collision = false;
+        for (const auto &testPoint: query) {
+            const auto &id2 = testPoint.Data;
+            if (id == id2) {
+                continue;
+            }
+
+            auto [verlet2, circle2] = ecs.template GetSeveral<Verlet, Circle>(id2);
+            auto overlapp = Overlapp(verlet.Position, verlet2.Position, circle.Radius, circle2.Radius);
+            if (!overlapp) {
+                continue;
+            }
+            collision = true;
+            auto newVelocity = UpdateCircleVelocity(verlet, verlet2);
+            avgVelocity += newVelocity;
+            verlet2.Velocity += sf::getNormalized(newVelocity) * sf::getLength(verlet2.Velocity) * -1.0f;
+            auto direction = verlet.Position - verlet2.Position;
+            avgDirection += normalize(direction) * *overlapp * 0.5f;
+            if (contacts) {
+                const float penetration = circle.Radius + circle2.Radius - sf::distance(verlet.Position, verlet2.Position);
+                contacts.Add({.Id1=id, .Id2=id2, .Normal=normalize(direction), .Penetration=penetration,
+                              .Impulse=verlet.Mass * sf::getLength(newVelocity)});
+            }
+        }
+        if (collision) {
+            verlet.Position += avgDirection;
+            auto length = sf::getLength(verlet.Velocity);
+            verlet.Velocity += sf::getNormalized(avgVelocity) * length;
+        }
+    }
+};
+
+struct VerletIntegrator {
+    void Accelerate(Verlet& verlet, float dt) const {
+        verlet.Velocity += verlet.Acceleration * dt;
+        verlet.Acceleration = {0, 0};
+    }
+
+    void Step(Verlet& verlet, float dt) const {
+        verlet.PreviousPosition = verlet.Position;
+        verlet.Update(dt);
+    }
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// Conservation and overlap checks of the last PhysimCpp::Run, filled only when PhysimConfig::Diagnostics is set.
+struct PhysimDiagnostics {
+    // Of the state the Run ended with, after the last substep.
+    double KineticEnergy = 0.0;
+    sf::Vector2<double> Momentum{};
+    // Over the contacts resolved in all substeps, counted the way PhysimCpp::GetContacts records them.
+    int Contacts = 0;
+    int LineContacts = 0;
+    float MaxPenetration = 0.0f;
+};
+
+// Timings of the last PhysimCpp::Run, in seconds.
+struct PhysimStats {
+    double VelocityTime = 0.0;
+    double QueryWaitTime = 0.0;
+    // Duration of the last finished query rebuild. Runs in parallel with the other phases in async mode.
+    double RebuildTime = 0.0;
+    double SolveTime = 0.0;
+    // Share of the instance's thread pool that was busy since the previous Run, 0 to 1.
+    double ThreadUtilization = 0.0;
+    int FramesSinceQuery = 0;
+    // Query rebuilds since construction, and their average per frame. With a skin a frame can rebuild more than once.
+    int QueryRebuilds = 0;
+    double RebuildRate = 0.0;
+    // Largest distance a circle has moved since the last rebuild, only tracked with a Verlet skin.
+    float MaxDisplacement = 0.0f;
+    // Particle steps taken over all substeps, below circles times substeps when step levels are in use.
+    int ParticleSteps = 0;
+    // Times the lines were baked into a distance field since construction, see PhysimConfig::LineFieldCellSize.
+    int LineFieldBakes = 0;
+    PhysimDiagnostics Diagnostics{};
+};
+
+// Coarse picture of the last broadphase rebuild, collected only when PhysimConfig::CollectSnapshot is set.
+struct BroadphaseSnapshot {
+    sf::FloatRect Area;
+    int Columns = 0;
+    int Rows = 0;
+    // Circles and summed neighbour list sizes per heat map cell, row major.
+    std::vector<uint32_t> Density;
+    std::vector<uint32_t> Neighbours;
+    // Cell bounds of the broadphase structure itself when the policy exposes them.
+    std::vector<sf::FloatRect> Cells;
+};
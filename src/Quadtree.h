@@ -0,0 +1,373 @@
+#pragma once
+
+#include "Components.h"
+#include "Memory.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+struct QuadtreeQuery {
+    sf::Vector2f Center;
+    float Radius = 0.0f;
+};
+
+// Point quadtree kept in flat arrays that are rebuilt in place, so once they have grown to the number of
+// points a rebuild does not allocate. Queries hand every match to a visitor instead of returning a vector.
+//
+// Build sorts the items by the Morton code of their position, after which every node is a contiguous range
+// [Begin, End) of items sharing a code prefix, and the children of a node are found by binary search on the
+// next two bits. Nodes are tested against the tight bounds of the points below them, which are gathered from
+// the leaves up once the tree is built.
+template <typename TData>
+class Quadtree {
+public:
+    using Item = DataWrapper<sf::Vector2f, TData>;
+    static constexpr uint32_t defaultLeafSize = 16;
+    static constexpr int maxDepth = 16;
+    // Depth below which a parallel build hands each subtree to a worker, up to 4^parallelDepth of them.
+    static constexpr int parallelDepth = 3;
+
+    // Largest number of items a node holds before it is split, takes effect from the next Build.
+    void SetLeafSize(uint32_t size) {
+        leafSize = std::max(size, 1u);
+    }
+
+    // Charges all storage to account from now on, drops what the tree holds.
+    void TrackMemory(MemoryAccount* account) {
+        const TrackingAllocator<std::byte> allocator(account);
+        items = TrackedVector<Item>(allocator);
+        nodes = TrackedVector<Node>(allocator);
+        keys = TrackedVector<uint32_t>(allocator);
+        sortedKeys = TrackedVector<uint32_t>(allocator);
+        sortedItems = TrackedVector<Item>(allocator);
+        histograms = TrackedVector<std::array<uint32_t, 256>>(allocator);
+        pending = TrackedVector<Subtree>(allocator);
+        subtrees = TrackedVector<TrackedVector<Node>>(allocator);
+    }
+
+    void Clear() {
+        items.clear();
+        nodes.clear();
+    }
+
+    void Add(const Item& item) {
+        items.push_back(item);
+    }
+
+    // Builds the tree over everything added since the last Clear, area is split evenly at every level. With a
+    // pool the codes, the radix sort and the subtrees below parallelDepth are spread over its workers, the
+    // result is the same either way.
+    void Build(const sf::FloatRect& area, ThreadPool* pool = nullptr) {
+        nodes.clear();
+        if (items.empty()) {
+            return;
+        }
+        SortByCode(area, pool);
+        pending.clear();
+        Split(nodes, 0, static_cast<uint32_t>(items.size()), 0, pool ? parallelDepth : maxDepth + 1);
+        if (subtrees.size() < pending.size()) {
+            subtrees.resize(pending.size(), TrackedVector<Node>(subtrees.get_allocator()));
+        }
+        ForEach(pool, pending.size(), [&](size_t task, size_t) {
+            subtrees[task].clear();
+            Split(subtrees[task], pending[task].Begin, pending[task].End, pending[task].Depth, maxDepth + 1);
+        });
+        for (size_t task = 0; task < pending.size(); task++) {
+            Attach(pending[task].Node, subtrees[task]);
+        }
+        // Children are always stored after their parent.
+        for (auto node = nodes.rbegin(); node != nodes.rend(); ++node) {
+            if (node->Leaf) {
+                continue;
+            }
+            bool first = true;
+            for (const auto child: node->Children) {
+                if (child < 0) {
+                    continue;
+                }
+                const auto& bounds = nodes[child];
+                node->Min = first ? bounds.Min : sf::Vector2f{std::min(node->Min.x, bounds.Min.x), std::min(node->Min.y, bounds.Min.y)};
+                node->Max = first ? bounds.Max : sf::Vector2f{std::max(node->Max.x, bounds.Max.x), std::max(node->Max.y, bounds.Max.y)};
+                first = false;
+            }
+        }
+    }
+
+    // Calls visit(item) for every item within query.Radius of query.Center.
+    template <typename TVisitor>
+    void Query(const QuadtreeQuery& query, TVisitor&& visit) const {
+        if (nodes.empty()) {
+            return;
+        }
+        const float radius2 = query.Radius * query.Radius;
+        std::array<uint32_t, 3 * maxDepth + 4> stack;
+        size_t size = 0;
+        stack[size++] = 0;
+        while (size > 0) {
+            const auto& node = nodes[stack[--size]];
+            if (!Reaches(node, query)) {
+                continue;
+            }
+            if (node.Leaf) {
+                VisitLeaf(node, query, radius2, visit);
+                continue;
+            }
+            for (auto child = node.Children.rbegin(); child != node.Children.rend(); ++child) {
+                if (*child >= 0) {
+                    stack[size++] = static_cast<uint32_t>(*child);
+                }
+            }
+        }
+    }
+
+    // Writes every match to out and returns the advanced iterator.
+    template <typename TOutput>
+    TOutput QueryInto(const QuadtreeQuery& query, TOutput out) const {
+        Query(query, [&](const Item& item) { *out++ = item; });
+        return out;
+    }
+
+    // Answers all queries in one traversal, calling visit(queryIndex, item) for every match. Each node passes on
+    // the queries that reach it, so nearby queries share the walk down the tree. The lists of active queries are
+    // allocated from scratch, which is expected to be a bump allocator reset by the caller. Matches of one query
+    // come in the same order as from Query.
+    template <typename TVisitor>
+    void QueryBatch(std::span<const QuadtreeQuery> queries, TVisitor&& visit, std::pmr::memory_resource& scratch) const {
+        if (nodes.empty() || queries.empty()) {
+            return;
+        }
+        std::pmr::vector<uint32_t> active(queries.size(), &scratch);
+        for (uint32_t i = 0; i < active.size(); i++) {
+            active[i] = i;
+        }
+        VisitBatch(0, queries, active, visit, scratch);
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return items.size();
+    }
+
+    // Calls visit(min, max) with the tight bounds of every leaf.
+    template <typename TVisitor>
+    void ForEachLeaf(TVisitor&& visit) const {
+        for (const auto& node: nodes) {
+            if (node.Leaf) {
+                visit(node.Min, node.Max);
+            }
+        }
+    }
+
+private:
+    struct Node {
+        sf::Vector2f Min;
+        sf::Vector2f Max;
+        uint32_t Begin = 0;
+        uint32_t End = 0;
+        bool Leaf = true;
+        std::array<int32_t, 4> Children{-1, -1, -1, -1};
+    };
+
+    struct Subtree {
+        size_t Node = 0;
+        uint32_t Begin = 0;
+        uint32_t End = 0;
+        int Depth = 0;
+    };
+
+    // Nodes at splitDepth that still need children are left for a later pass, see Build.
+    void Split(TrackedVector<Node>& out, uint32_t begin, uint32_t end, int depth, int splitDepth) {
+        const auto index = out.size();
+        auto& node = out.emplace_back();
+        node.Begin = begin;
+        node.End = end;
+        if (end - begin <= leafSize || depth == maxDepth) {
+            node.Min = node.Max = items[begin].Vector;
+            for (auto i = begin; i < end; i++) {
+                const auto& position = items[i].Vector;
+                node.Min = {std::min(node.Min.x, position.x), std::min(node.Min.y, position.y)};
+                node.Max = {std::max(node.Max.x, position.x), std::max(node.Max.y, position.y)};
+            }
+            return;
+        }
+        node.Leaf = false;
+        if (depth == splitDepth) {
+            pending.push_back({index, begin, end, depth});
+            return;
+        }
+        const auto shift = 2 * (maxDepth - 1 - depth);
+        auto childBegin = begin;
+        for (uint32_t quadrant = 0; quadrant < 4; quadrant++) {
+            const auto childEnd = static_cast<uint32_t>(
+                    std::partition_point(keys.begin() + childBegin, keys.begin() + end, [&](uint32_t key) {
+                        return ((key >> shift) & 3u) <= quadrant;
+                    }) - keys.begin());
+            if (childEnd != childBegin) {
+                out[index].Children[quadrant] = static_cast<int32_t>(out.size());
+                Split(out, childBegin, childEnd, depth + 1, splitDepth);
+            }
+            childBegin = childEnd;
+        }
+    }
+
+    // Moves a subtree built on its own into nodes, its root replaces the node it was built for.
+    void Attach(size_t root, const TrackedVector<Node>& subtree) {
+        const auto base = static_cast<int32_t>(nodes.size()) - 1;
+        const auto remap = [&](int32_t child) {
+            return child < 0 ? child : child + base;
+        };
+        for (size_t i = 0; i < subtree.size(); i++) {
+            auto node = subtree[i];
+            for (auto& child: node.Children) {
+                child = remap(child);
+            }
+            if (i == 0) {
+                nodes[root] = node;
+            } else {
+                nodes.push_back(node);
+            }
+        }
+    }
+
+    static uint32_t Spread(uint32_t value) {
+        value = (value | (value << 8)) & 0x00FF00FFu;
+        value = (value | (value << 4)) & 0x0F0F0F0Fu;
+        value = (value | (value << 2)) & 0x33333333u;
+        value = (value | (value << 1)) & 0x55555555u;
+        return value;
+    }
+
+    // Quantizes positions to maxDepth bits per axis, the two bits at every level pick the quadrant in the order
+    // the children are stored in, then sorts the items with a stable LSD radix sort on one byte at a time.
+    void SortByCode(const sf::FloatRect& area, ThreadPool* pool) {
+        const auto n = items.size();
+        constexpr float cells = 1 << maxDepth;
+        const float scaleX = area.width > 0 ? cells / area.width : 0.0f;
+        const float scaleY = area.height > 0 ? cells / area.height : 0.0f;
+        const auto nrChunks = pool ? std::min(pool->Size() * 4, n / 1024 + 1) : 1;
+        const auto chunkSize = (n + nrChunks - 1) / nrChunks;
+        const auto chunkRange = [&](size_t chunk) {
+            return std::pair{std::min(chunk * chunkSize, n), std::min((chunk + 1) * chunkSize, n)};
+        };
+        keys.resize(n);
+        sortedKeys.resize(n);
+        sortedItems.resize(n);
+        histograms.resize(nrChunks);
+        ForEach(pool, nrChunks, [&](size_t chunk, size_t) {
+            const auto [begin, end] = chunkRange(chunk);
+            for (auto i = begin; i < end; i++) {
+                const auto& position = items[i].Vector;
+                const auto x = static_cast<uint32_t>(std::clamp((position.x - area.left) * scaleX, 0.0f, cells - 1));
+                const auto y = static_cast<uint32_t>(std::clamp((position.y - area.top) * scaleY, 0.0f, cells - 1));
+                keys[i] = Spread(x) | (Spread(y) << 1);
+            }
+        });
+        for (uint32_t shift = 0; shift < 32; shift += 8) {
+            ForEach(pool, nrChunks, [&](size_t chunk, size_t) {
+                auto& histogram = histograms[chunk];
+                histogram.fill(0);
+                const auto [begin, end] = chunkRange(chunk);
+                for (auto i = begin; i < end; i++) {
+                    histogram[(keys[i] >> shift) & 0xFFu]++;
+                }
+            });
+            uint32_t offset = 0;
+            bool sorted = false;
+            for (size_t digit = 0; digit < 256; digit++) {
+                uint32_t count = 0;
+                for (auto& histogram: histograms) {
+                    count += histogram[digit];
+                }
+                // Every key has the same digit, the pass would not move anything.
+                sorted = sorted || count == n;
+                for (auto& histogram: histograms) {
+                    const auto chunkCount = histogram[digit];
+                    histogram[digit] = offset;
+                    offset += chunkCount;
+                }
+            }
+            if (sorted) {
+                continue;
+            }
+            ForEach(pool, nrChunks, [&](size_t chunk, size_t) {
+                auto& histogram = histograms[chunk];
+                const auto [begin, end] = chunkRange(chunk);
+                for (auto i = begin; i < end; i++) {
+                    const auto target = histogram[(keys[i] >> shift) & 0xFFu]++;
+                    sortedKeys[target] = keys[i];
+                    sortedItems[target] = items[i];
+                }
+            });
+            std::swap(keys, sortedKeys);
+            std::swap(items, sortedItems);
+        }
+    }
+
+    template <typename TFunction>
+    static void ForEach(ThreadPool* pool, size_t count, const TFunction& fn) {
+        if (pool) {
+            pool->ParallelFor(count, fn);
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                fn(i, 0);
+            }
+        }
+    }
+
+    static bool Reaches(const Node& node, const QuadtreeQuery& query) {
+        const float dx = query.Center.x - std::clamp(query.Center.x, node.Min.x, node.Max.x);
+        const float dy = query.Center.y - std::clamp(query.Center.y, node.Min.y, node.Max.y);
+        return dx * dx + dy * dy <= query.Radius * query.Radius;
+    }
+
+    template <typename TVisitor>
+    void VisitLeaf(const Node& node, const QuadtreeQuery& query, float radius2, TVisitor&& visit) const {
+        for (auto i = node.Begin; i < node.End; i++) {
+            const auto delta = items[i].Vector - query.Center;
+            if (delta.x * delta.x + delta.y * delta.y <= radius2) {
+                visit(items[i]);
+            }
+        }
+    }
+
+    template <typename TVisitor>
+    void VisitBatch(uint32_t index, std::span<const QuadtreeQuery> queries, const std::pmr::vector<uint32_t>& active,
+                    TVisitor& visit, std::pmr::memory_resource& scratch) const {
+        const auto& node = nodes[index];
+        std::pmr::vector<uint32_t> reaching(&scratch);
+        reaching.reserve(active.size());
+        for (const auto query: active) {
+            if (Reaches(node, queries[query])) {
+                reaching.push_back(query);
+            }
+        }
+        if (reaching.empty()) {
+            return;
+        }
+        if (node.Leaf) {
+            for (const auto query: reaching) {
+                VisitLeaf(node, queries[query], queries[query].Radius * queries[query].Radius,
+                          [&](const Item& item) { visit(query, item); });
+            }
+            return;
+        }
+        for (const auto child: node.Children) {
+            if (child >= 0) {
+                VisitBatch(static_cast<uint32_t>(child), queries, reaching, visit, scratch);
+            }
+        }
+    }
+
+    uint32_t leafSize = defaultLeafSize;
+    TrackedVector<Item> items;
+    TrackedVector<Node> nodes;
+    TrackedVector<uint32_t> keys;
+    TrackedVector<uint32_t> sortedKeys;
+    TrackedVector<Item> sortedItems;
+    TrackedVector<std::array<uint32_t, 256>> histograms;
+    TrackedVector<Subtree> pending;
+    TrackedVector<TrackedVector<Node>> subtrees;
+};
@@ -0,0 +1,88 @@
+#include "StateExport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+size_t SlotSize(uint32_t capacity) {
+    return sizeof(StateExportSlot) + capacity * sizeof(ExportedParticle);
+}
+
+size_t MappingSize(uint32_t capacity, uint32_t nrSlots) {
+    return sizeof(StateExportHeader) + nrSlots * SlotSize(capacity);
+}
+
+}
+
+static_assert(sizeof(StateExportSlot) % alignof(ExportedParticle) == 0);
+static_assert(sizeof(ExportedParticle) % alignof(StateExportSlot) == 0);
+
+StateExporter::StateExporter(const std::string &name, uint32_t capacity, uint32_t nrSlots)
+: name(name)
+, slotSize(SlotSize(capacity))
+, size(MappingSize(capacity, std::max(nrSlots, 2u))) {
+    nrSlots = std::max(nrSlots, 2u);
+    // Exclusive, so a second exporter with the same name fails instead of truncating the first one's object and
+    // removing it when it is destroyed.
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(errno == EEXIST ? "StateExporter: " + name + " is already exported"
+                                                 : "StateExporter: shm_open failed");
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("StateExporter: ftruncate failed");
+    }
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("StateExporter: mmap failed");
+    }
+    header = new(memory) StateExportHeader{.NrSlots=nrSlots, .Capacity=capacity};
+    for (uint32_t i = 0; i < nrSlots; i++) {
+        new(&Slot(i)) StateExportSlot{};
+    }
+}
+
+StateExporter::~StateExporter() {
+    munmap(header, size);
+    shm_unlink(name.c_str());
+}
+
+StateExportReader::StateExportReader(const std::string &name) {
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("StateExportReader: shm_open failed");
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(StateExportHeader)) {
+        close(fd);
+        throw std::runtime_error("StateExportReader: no exported state");
+    }
+    size = static_cast<size_t>(info.st_size);
+    void *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("StateExportReader: mmap failed");
+    }
+    header = static_cast<const StateExportHeader *>(memory);
+    if (header->Magic != StateExportHeader::magic || header->Version != StateExportHeader::version ||
+        header->NrSlots == 0 || MappingSize(header->Capacity, header->NrSlots) > size) {
+        munmap(memory, size);
+        throw std::runtime_error("StateExportReader: incompatible exported state");
+    }
+    slotSize = SlotSize(header->Capacity);
+}
+
+StateExportReader::~StateExportReader() {
+    munmap(const_cast<StateExportHeader *>(header), size);
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Publishes particle state to other processes on the same machine through a named POSIX shared memory object.
+// The object holds a StateExportHeader followed by NrSlots slots, each a StateExportSlot followed by Capacity
+// particles. Frames are written round robin into the slots, each slot guarded by a seqlock: its Sequence is odd
+// while the writer is inside it, so the writer never waits for readers and readers never copy a frame they
+// only want to look at.
+
+struct ExportedParticle {
+    float X = 0.0f;
+    float Y = 0.0f;
+    float Radius = 0.0f;
+    // Packed as 0xRRGGBBAA, the same as sf::Color::toInteger.
+    uint32_t Color = 0;
+};
+
+struct StateExportHeader {
+    static constexpr uint32_t magic = 0x50485359;
+    static constexpr uint32_t version = 1;
+
+    uint32_t Magic = magic;
+    uint32_t Version = version;
+    uint32_t NrSlots = 0;
+    uint32_t Capacity = 0;
+    // Number of frames published so far, the newest is in slot (Published - 1) % NrSlots.
+    std::atomic<uint64_t> Published = 0;
+};
+
+struct StateExportSlot {
+    std::atomic<uint64_t> Sequence = 0;
+    uint64_t Frame = 0;
+    // Particles in the frame, at most Capacity. Total is how many the simulation had.
+    uint32_t Count = 0;
+    uint32_t Total = 0;
+
+    ExportedParticle *Particles() {
+        return reinterpret_cast<ExportedParticle *>(this + 1);
+    }
+
+    const ExportedParticle *Particles() const {
+        return reinterpret_cast<const ExportedParticle *>(this + 1);
+    }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// Creates the shared memory object on construction and removes it on destruction. Throws std::runtime_error when
+// the object can not be created, also when it already exists.
+class StateExporter {
+public:
+    StateExporter(const std::string &name, uint32_t capacity, uint32_t nrSlots = 4);
+    ~StateExporter();
+
+    StateExporter(const StateExporter &) = delete;
+    StateExporter &operator=(const StateExporter &) = delete;
+
+    // Room for the next frame, written in place. Readers skip the slot until EndFrame.
+    std::span<ExportedParticle> BeginFrame() {
+        auto &slot = Slot(header->Published.load(std::memory_order_relaxed));
+        sequence = slot.Sequence.load(std::memory_order_relaxed);
+        slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return {slot.Particles(), header->Capacity};
+    }
+
+    void EndFrame(uint32_t count, uint32_t total) {
+        const auto published = header->Published.load(std::memory_order_relaxed);
+        auto &slot = Slot(published);
+        slot.Frame = published;
+        slot.Count = count;
+        slot.Total = total;
+        slot.Sequence.store(sequence + 2, std::memory_order_release);
+        header->Published.store(published + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] const std::string &GetName() const {
+        return name;
+    }
+
+private:
+    StateExportSlot &Slot(uint64_t frame) {
+        return *reinterpret_cast<StateExportSlot *>(reinterpret_cast<std::byte *>(header + 1) +
+                                                     frame % header->NrSlots * slotSize);
+    }
+
+    std::string name;
+    size_t slotSize = 0;
+    size_t size = 0;
+    StateExportHeader *header = nullptr;
+    uint64_t sequence = 0;
+};
+
+// Maps an exported state read only, for use in another process.
+class StateExportReader {
+public:
+    explicit StateExportReader(const std::string &name);
+    ~StateExportReader();
+
+    StateExportReader(const StateExportReader &) = delete;
+    StateExportReader &operator=(const StateExportReader &) = delete;
+
+    // Calls view(particles, frame, total) on the newest frame, in place. The writer only comes back to a slot
+    // after NrSlots - 1 newer frames, if it did so while view ran this returns false and what view saw has to be
+    // thrown away. Also returns false, without calling view, before the first frame.
+    template<typename TView>
+    bool ReadLatest(TView &&view) const {
+        const auto published = header->Published.load(std::memory_order_acquire);
+        if (published == 0) {
+            return false;
+        }
+        const auto &slot = Slot(published - 1);
+        const auto sequence = slot.Sequence.load(std::memory_order_acquire);
+        if (sequence % 2 != 0) {
+            return false;
+        }
+        const auto count = std::min(slot.Count, header->Capacity);
+        view(std::span<const ExportedParticle>(slot.Particles(), count), slot.Frame, slot.Total);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.Sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    [[nodiscard]] uint64_t GetPublished() const {
+        return header->Published.load(std::memory_order_acquire);
+    }
+
+private:
+    const StateExportSlot &Slot(uint64_t frame) const {
+        return *reinterpret_cast<const StateExportSlot *>(reinterpret_cast<const std::byte *>(header + 1) +
+                                                           frame % header->NrSlots * slotSize);
+    }
+
+    size_t slotSize = 0;
+    size_t size = 0;
+    const StateExportHeader *header = nullptr;
+};
@@ -5,10 +5,16 @@
 #include "System.h"
 #include "Util.h"
 #include "Physics.h"
+#include "Overlay.h"
+#include "Camera.h"
+#include "Memory.h"
+#include "ParticlePool.h"
 #include <iostream>
 #include <cassert>
 #include <SFMLMath.hpp>
 
+constexpr float lodRadius = 1.0f;
+
 constexpr float PI_VertexPerCircle() {
     return M_PI / vertexPerCircle;
 }
@@ -46,17 +52,30 @@ void RenderSystem::Run(const Config &config) {
     std::vector<ecs::EntityID> entitiesToRemove;
     std::optional<sf::Vector2f> hoveredPos = config.hoveredId ? config.Ecs.Get<Verlet>(config.hoveredId).Position
                                                               : std::optional<sf::Vector2f>();
-    sf::VertexArray points(pointRendering ? sf::Points : sf::Triangles);
-    points.resize(config.Ecs.Size());
+    sf::VertexArray points(config.PointRendering ? sf::Points : sf::Triangles);
+    const auto visible = config.Viewport ? config.Viewport->GetVisibleArea() : config.worldBoundrarys.GetBox();
+    // Circles with a radius below this are splatted, the layer is only started once the first one is.
+    const float splatRadius = config.Viewport && config.Lod ? lodRadius / config.Viewport->GetPixelsPerUnit() : 0.0f;
+    bool splatted = false;
+    if (config.Viewport) {
+        config.Window.setView(config.Viewport->GetView());
+    }
 
     for (const auto &[circle, verlet, id, octreeQuery]: config.Ecs.GetSystem<Circle, Verlet, ecs::EntityID, octreeQuery>()) {
+        if (!config.worldBoundrarys.GetBox().contains(verlet.Position) && !(config.Pool && config.Pool->IsParked(id))) {
+            entitiesToRemove.push_back(id);
+        }
+        if (verlet.Position.x + circle.Radius < visible.left || verlet.Position.x - circle.Radius > visible.left + visible.width ||
+            verlet.Position.y + circle.Radius < visible.top || verlet.Position.y - circle.Radius > visible.top + visible.height) {
+            continue;
+        }
         sf::Color color;
         if (id == config.hoveredId) {
             color = sf::Color::Red;
         } else {
             if (hoveredPos) {
                 auto distance = sf::distance(verlet.Position, *hoveredPos);
-                if (distance <= circle.Radius + queryRadius) {
+                if (distance <= circle.Radius + config.QueryRadius) {
                     color = sf::Color::Green;
                 } else {
                     color = circle.Color;
@@ -65,15 +84,21 @@ void RenderSystem::Run(const Config &config) {
                 color = circle.Color;
             }
         }
-        if (pointRendering) {
+        if (circle.Radius < splatRadius) {
+            if (!splatted) {
+                config.Lod->Begin(visible, config.Window.getSize());
+                splatted = true;
+            }
+            config.Lod->Splat(verlet.Position, color);
+        } else if (config.PointRendering) {
             addPoint(points, verlet.Position, color);
         } else {
             addCircle(points, verlet.Position, circle.Radius, color);
         }
         if (id == config.hoveredId) {
             sf::CircleShape outline;
-            outline.setRadius(circle.Radius + queryRadius);
-            outline.setOrigin(circle.Radius + queryRadius, circle.Radius + queryRadius);
+            outline.setRadius(circle.Radius + config.QueryRadius);
+            outline.setOrigin(circle.Radius + config.QueryRadius, circle.Radius + config.QueryRadius);
             outline.setPosition(verlet.Position);
             outline.setFillColor(sf::Color::Transparent);
             outline.setOutlineColor(sf::Color::Red);
@@ -111,10 +136,6 @@ void RenderSystem::Run(const Config &config) {
             idText.setPosition(verlet.Position - sf::Vector2f{50, 150.0f});
             config.Window.draw(idText);
         }
-
-        if (!config.worldBoundrarys.GetBox().contains(verlet.Position)) {
-            entitiesToRemove.push_back(id);
-        }
     }
 
     for (const auto &[line]: config.Ecs.GetSystem<Line>()) {
@@ -125,35 +146,37 @@ void RenderSystem::Run(const Config &config) {
         config.Window.draw(lineShape, 2, sf::Lines);
     }
 
-    /*
-    auto octree = MakeOctree(config.Ecs, config.worldBoundrarys);
-    for (const auto& boundrary : octree.GetBoundaries()) {
-        sf::RectangleShape rectangle;
-        auto boundrarySize = boundrary.GetSize();
-        rectangle.setSize({boundrarySize.x, boundrarySize.y});
-        rectangle.setPosition({boundrary.Min.x, boundrary.Min.y});
-        rectangle.setFillColor(sf::Color::Transparent);
-        rectangle.setOutlineColor(sf::Color::White);
-        rectangle.setOutlineThickness(1);
-        config.Window.draw(rectangle);
+    if (config.VertexMemory) {
+        config.VertexMemory->Sample(points.getVertexCount() * sizeof(sf::Vertex));
     }
-     */
-
     config.fpsText.setString(config.FpsText);
     config.nrPoints.setString(std::to_string(config.Ecs.Size()));
+    if (splatted) {
+        config.Lod->Draw(config.Window);
+    }
     config.Window.draw(points);
+    if (config.Overlay) {
+        config.Overlay->Draw(config.Window, *config.fpsText.getFont());
+    }
+    config.Window.setView(config.Window.getDefaultView());
     config.Window.draw(config.fpsText);
     config.Window.draw(config.nrPoints);
     config.Window.display();
 
     for (const auto &id: entitiesToRemove) {
-        config.Ecs.RemoveEntity(id);
+        if (config.Pool) {
+            config.Pool->Release(id);
+        } else {
+            config.Ecs.RemoveEntity(id);
+        }
     }
 }
 
 void GravitySystem::Run(const Config &config) {
-    for (const auto &[verlet]: config.Ecs.GetSystem<Verlet>()) {
-        verlet.Acceleration += {0, 9.81f};
+    for (const auto &[verlet]: config.Ecs.GetSystemPart<Verlet>(config.Part, config.NrParts)) {
+        if (!verlet.Parked) {
+            verlet.Acceleration += {0, 9.81f};
+        }
     }
 }
 
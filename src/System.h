@@ -12,6 +12,12 @@ namespace sf {
     class RenderWindow;
 }
 struct WorldBoundrarys;
+class PerformanceOverlay;
+class Camera;
+class DensityLayer;
+class MemoryAccount;
+template <typename TEcs>
+class ParticlePool;
 
 
 namespace RenderSystem {
@@ -24,6 +30,17 @@ namespace RenderSystem {
         WorldBoundrarys &worldBoundrarys;
         ecs::EntityID hoveredId;
         Lines& lines;
+        float QueryRadius = queryRadius;
+        bool PointRendering = pointRendering;
+        const PerformanceOverlay *Overlay = nullptr;
+        // Without a viewport the whole world is drawn at one pixel per unit. Circles outside the viewport are
+        // culled, and once they are smaller than lodRadius pixels they are splatted into Lod when it is set.
+        const Camera *Viewport = nullptr;
+        DensityLayer *Lod = nullptr;
+        // Sampled with the size of the frame's vertex array when set.
+        MemoryAccount *VertexMemory = nullptr;
+        // Circles that leave the world are released to the pool when set, otherwise removed from the ECS.
+        ParticlePool<ECS> *Pool = nullptr;
     };
 
     void Run(const Config &);
@@ -43,6 +60,9 @@ namespace GravitySystem {
     struct Config {
         ECS &Ecs;
         float dt = 0.0f;
+        // Applies gravity to one of NrParts equal chunks of the entities.
+        int Part = 0;
+        int NrParts = 1;
     };
 
     void Run(const Config &);
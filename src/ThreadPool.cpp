@@ -0,0 +1,160 @@
+#include "ThreadPool.h"
+
+#include <utility>
+
+namespace {
+
+// The pool whose job the thread is running, so a job can dispatch to another pool without being treated as
+// nested.
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+int64_t Nanoseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+ThreadPool::ThreadPool(size_t nrThreads) {
+    for (size_t i = 1; i < nrThreads; i++) {
+        threads.emplace_back([this, worker = i - 1]() { Work(worker); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Dispatch(size_t count, Job newJob, const void *context) {
+    if (count == 0) {
+        return;
+    }
+    if (currentPool == this) {
+        for (size_t i = 0; i < count; i++) {
+            newJob(context, i, currentWorker);
+        }
+        return;
+    }
+
+    std::lock_guard dispatchLock(dispatchMutex);
+    if (threads.empty() || count == 1) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto previousPool = std::exchange(currentPool, this);
+        const auto previousWorker = std::exchange(currentWorker, threads.size());
+        for (size_t i = 0; i < count; i++) {
+            newJob(context, i, currentWorker);
+        }
+        currentPool = previousPool;
+        currentWorker = previousWorker;
+        busyTime += Nanoseconds(start);
+        return;
+    }
+    {
+        std::lock_guard lock(mutex);
+        job = newJob;
+        jobContext = context;
+        jobCount = count;
+        nextIndex = 0;
+        activeWorkers = threads.size();
+        generation++;
+    }
+    wake.notify_all();
+    RunJob(threads.size());
+
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this]() { return activeWorkers == 0; });
+}
+
+void ThreadPool::RunJob(size_t worker) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto previousPool = std::exchange(currentPool, this);
+    const auto previousWorker = std::exchange(currentWorker, worker);
+    for (size_t i = nextIndex++; i < jobCount; i = nextIndex++) {
+        job(jobContext, i, worker);
+    }
+    currentPool = previousPool;
+    currentWorker = previousWorker;
+    busyTime += Nanoseconds(start);
+}
+
+void ThreadPool::Work(size_t worker) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+        RunJob(worker);
+        std::lock_guard lock(mutex);
+        if (--activeWorkers == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+BackgroundTask::BackgroundTask(std::function<void()> task)
+: task(std::move(task)) {
+}
+
+BackgroundTask::~BackgroundTask() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::unique_lock lock(mutex);
+        done.wait(lock, [this]() { return !running; });
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void BackgroundTask::Start() {
+    if (!thread.joinable()) {
+        thread = std::thread([this]() { Work(); });
+    }
+    {
+        std::lock_guard lock(mutex);
+        running = true;
+    }
+    wake.notify_all();
+}
+
+bool BackgroundTask::IsRunning() const {
+    std::lock_guard lock(mutex);
+    return running;
+}
+
+void BackgroundTask::Wait() {
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this]() { return !running; });
+}
+
+void BackgroundTask::Work() {
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this]() { return stopping || running; });
+            if (stopping) {
+                return;
+            }
+        }
+        task();
+        {
+            std::lock_guard lock(mutex);
+            running = false;
+        }
+        done.notify_all();
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t nrThreads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of workers that can run a job at once, including the calling thread.
+    [[nodiscard]] size_t Size() const { return threads.size() + 1; }
+
+    // Total time workers, including calling threads, have spent running jobs.
+    [[nodiscard]] std::chrono::nanoseconds GetBusyTime() const { return std::chrono::nanoseconds(busyTime.load()); }
+
+    // Calls fn(index, worker) for every index in [0, count) and returns when all are done. Worker is in
+    // [0, Size()) and unique among concurrently running calls, so it can index per thread scratch data.
+    // Nested calls from inside one of this pool's jobs run inline on the calling worker, a job may dispatch to
+    // another pool.
+    template<typename TFunction>
+    void ParallelFor(size_t count, const TFunction &fn) {
+        Dispatch(count, [](const void *context, size_t index, size_t worker) {
+            (*static_cast<const TFunction *>(context))(index, worker);
+        }, &fn);
+    }
+
+private:
+    using Job = void (*)(const void *, size_t, size_t);
+
+    void Dispatch(size_t count, Job job, const void *context);
+    void RunJob(size_t worker);
+    void Work(size_t worker);
+
+    std::vector<std::thread> threads;
+    std::mutex dispatchMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Job job = nullptr;
+    const void *jobContext = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex = 0;
+    std::atomic<int64_t> busyTime = 0;
+    size_t activeWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+// Runs the same task on a dedicated thread each time Start is called, without allocating per run.
+// The thread is created on the first Start.
+class BackgroundTask {
+public:
+    explicit BackgroundTask(std::function<void()> task);
+    ~BackgroundTask();
+
+    BackgroundTask(const BackgroundTask &) = delete;
+    BackgroundTask &operator=(const BackgroundTask &) = delete;
+
+    // Must not be called while a previous run is still in progress.
+    void Start();
+
+    [[nodiscard]] bool IsRunning() const;
+
+    void Wait();
+
+private:
+    void Work();
+
+    std::function<void()> task;
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool running = false;
+    bool stopping = false;
+};
@@ -0,0 +1,220 @@
+#include "Transport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <stdexcept>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+class UnixSocketChannel : public Channel {
+public:
+    explicit UnixSocketChannel(int fd)
+    : fd(fd) {
+    }
+
+    ~UnixSocketChannel() override {
+        close(fd);
+    }
+
+    void Send(std::span<const std::byte> message) override {
+        uint64_t size = message.size();
+        Write(&size, sizeof(size));
+        Write(message.data(), message.size());
+    }
+
+    void Receive(std::vector<std::byte> &message) override {
+        uint64_t size = 0;
+        Read(&size, sizeof(size));
+        message.resize(size);
+        Read(message.data(), message.size());
+    }
+
+private:
+    // MSG_NOSIGNAL turns a write to a peer that is gone into an error instead of a SIGPIPE killing the process.
+    void Write(const void *data, size_t size) {
+        auto bytes = static_cast<const std::byte *>(data);
+        while (size > 0) {
+            auto written = send(fd, bytes, size, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                throw std::runtime_error("UnixSocketChannel: write failed");
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+
+    void Read(void *data, size_t size) {
+        auto bytes = static_cast<std::byte *>(data);
+        while (size > 0) {
+            auto received = read(fd, bytes, size);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                throw std::runtime_error("UnixSocketChannel: read failed");
+            }
+            bytes += received;
+            size -= received;
+        }
+    }
+
+    int fd;
+};
+
+// Single producer, single consumer slot in shared memory. Messages larger than the slot are sent in parts.
+struct Mailbox {
+    std::atomic<uint32_t> Full;
+    uint32_t Last;
+    uint64_t Size;
+
+    std::byte *Data() {
+        return reinterpret_cast<std::byte *>(this + 1);
+    }
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+class SharedMemoryChannel : public Channel {
+public:
+    SharedMemoryChannel(std::shared_ptr<void> mapping, Mailbox *outgoing, Mailbox *incoming, size_t capacity)
+    : mapping(std::move(mapping))
+    , outgoing(outgoing)
+    , incoming(incoming)
+    , capacity(capacity) {
+    }
+
+    void Send(std::span<const std::byte> message) override {
+        do {
+            WaitFor(*outgoing, 0);
+            const auto part = std::min(message.size(), capacity);
+            std::copy_n(message.begin(), part, outgoing->Data());
+            outgoing->Size = part;
+            outgoing->Last = part == message.size();
+            message = message.subspan(part);
+            outgoing->Full.store(1, std::memory_order_release);
+        } while (!message.empty());
+    }
+
+    void Receive(std::vector<std::byte> &message) override {
+        message.clear();
+        bool last = false;
+        while (!last) {
+            WaitFor(*incoming, 1);
+            message.insert(message.end(), incoming->Data(), incoming->Data() + incoming->Size);
+            last = incoming->Last;
+            incoming->Full.store(0, std::memory_order_release);
+        }
+    }
+
+private:
+    static void WaitFor(Mailbox &mailbox, uint32_t state) {
+        while (mailbox.Full.load(std::memory_order_acquire) != state) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::shared_ptr<void> mapping;
+    Mailbox *outgoing;
+    Mailbox *incoming;
+    size_t capacity;
+};
+
+// Waits for every child, true when all of them exited successfully.
+bool Reap(const std::vector<pid_t> &children) {
+    bool success = true;
+    for (auto pid: children) {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        success = success && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return success;
+}
+
+}
+
+ChannelPair MakeUnixSocketChannels() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        throw std::runtime_error("MakeUnixSocketChannels: socketpair failed");
+    }
+    return {std::make_unique<UnixSocketChannel>(fds[0]), std::make_unique<UnixSocketChannel>(fds[1])};
+}
+
+ChannelPair MakeSharedMemoryChannels(size_t capacity) {
+    capacity = (capacity + alignof(Mailbox) - 1) / alignof(Mailbox) * alignof(Mailbox);
+    const size_t mailboxSize = sizeof(Mailbox) + capacity;
+    const size_t size = 2 * mailboxSize;
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("MakeSharedMemoryChannels: mmap failed");
+    }
+    std::shared_ptr<void> mapping(memory, [size](void *p) { munmap(p, size); });
+    auto first = new(memory) Mailbox{};
+    auto second = new(static_cast<std::byte *>(memory) + mailboxSize) Mailbox{};
+    return {std::make_unique<SharedMemoryChannel>(mapping, first, second, capacity),
+            std::make_unique<SharedMemoryChannel>(mapping, second, first, capacity)};
+}
+
+ChannelPair MakeChannels(TransportType type) {
+    if (type == TransportType::SharedMemory) {
+        return MakeSharedMemoryChannels();
+    }
+    return MakeUnixSocketChannels();
+}
+
+bool RunSlabProcesses(int nrSlabs, TransportType type, const SlabProcess &process) {
+    std::vector<ChannelPair> links;
+    for (int i = 0; i + 1 < nrSlabs; i++) {
+        links.push_back(MakeChannels(type));
+    }
+
+    std::vector<pid_t> children;
+    for (int slab = 0; slab < nrSlabs; slab++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            // The slabs already running would wait for their missing neighbour forever.
+            for (auto child: children) {
+                kill(child, SIGKILL);
+            }
+            Reap(children);
+            throw std::runtime_error("RunSlabProcesses: fork failed");
+        }
+        if (pid == 0) {
+            // Only the two ends of this slab stay open, so a neighbour exiting closes its link for good and a
+            // blocked Receive fails instead of waiting on a copy of the other end held by some other slab.
+            for (int i = 0; i + 1 < nrSlabs; i++) {
+                if (i != slab - 1) {
+                    links[i].second.reset();
+                }
+                if (i != slab) {
+                    links[i].first.reset();
+                }
+            }
+            Channel *lower = slab > 0 ? links[slab - 1].second.get() : nullptr;
+            Channel *upper = slab + 1 < nrSlabs ? links[slab].first.get() : nullptr;
+            int status = 0;
+            try {
+                process(slab, lower, upper);
+            } catch (...) {
+                status = 1;
+            }
+            _exit(status);
+        }
+        children.push_back(pid);
+    }
+    // The parent uses none of the links.
+    links.clear();
+
+    return Reap(children);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+// One bidirectional link between two processes. Send and Receive block, and a message is always received whole.
+class Channel {
+public:
+    virtual ~Channel() = default;
+
+    virtual void Send(std::span<const std::byte> message) = 0;
+
+    virtual void Receive(std::vector<std::byte> &message) = 0;
+};
+
+enum class TransportType {
+    UnixSocket,
+    SharedMemory
+};
+
+using ChannelPair = std::pair<std::unique_ptr<Channel>, std::unique_ptr<Channel>>;
+
+// Both ends have to be created before the processes that use them are forked.
+ChannelPair MakeUnixSocketChannels();
+
+ChannelPair MakeSharedMemoryChannels(size_t capacity = 1 << 20);
+
+ChannelPair MakeChannels(TransportType type);
+
+// Forks one process per slab, slab i gets channels to slab i - 1 and i + 1 (nullptr at the ends). A slab that
+// throws or exits closes its links, so its neighbours' Send and Receive throw instead of blocking. Returns true
+// when every process exited successfully, throws when a fork fails after killing the slabs already started.
+using SlabProcess = std::function<void(int slab, Channel *lower, Channel *upper)>;
+
+bool RunSlabProcesses(int nrSlabs, TransportType type, const SlabProcess &process);
@@ -11,7 +11,7 @@
 #include <future>
 #include <chrono>
 
-using ECS = ecs::ECSManager<Circle, Verlet, ecs::EntityID, octreeQuery, Line>;
+using ECS = ecs::ECSManager<Circle, Verlet, ecs::EntityID, octreeQuery, Line, Emitter>;
 
 using Lines = std::vector<Line>;
 static constexpr float circleRadius = 1.5f;
@@ -35,8 +35,8 @@ struct WorldBoundrarys {
 using Octree = OctreeCpp<sf::Vector2f, ecs::EntityID>;
 
 Octree MakeOctree(auto &ecs, const WorldBoundrarys &worldBoundrarys) {
-    Octree octree({{0,                      0},
-                   {worldBoundrarys.Size.x, worldBoundrarys.Size.y}});
+    Octree octree({{worldBoundrarys.Position.x,                          worldBoundrarys.Position.y},
+                   {worldBoundrarys.Position.x + worldBoundrarys.Size.x, worldBoundrarys.Position.y + worldBoundrarys.Size.y}});
 
     for (const auto &[verlet, id]: ecs.template GetSystem<Verlet, ecs::EntityID>()) {
         if (worldBoundrarys.GetBox().contains(verlet.Position)) {
@@ -47,6 +47,20 @@ Octree MakeOctree(auto &ecs, const WorldBoundrarys &worldBoundrarys) {
     return octree;
 }
 
+// Bytes held by the components of every entity, from the component sizes. The ECS's own bookkeeping is not
+// included.
+template<typename... Ts>
+size_t ComponentBytes(ecs::ECSManager<Ts...> &ecs) {
+    const auto bytes = [&]<typename T>() {
+        size_t count = 0;
+        for ([[maybe_unused]] const auto &component: ecs.template GetSystem<T>()) {
+            count++;
+        }
+        return count * sizeof(T);
+    };
+    return (bytes.template operator()<Ts>() + ...);
+}
+
 double SegmentSegmentDistance(const sf::Vector2f &L1Start, const sf::Vector2f &L1End, const sf::Vector2f &L2Start,
                               const sf::Vector2f &L2End);
 
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "ParticleRecord.h"
+#include "Util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Pages resting parts of a large world out of the ECS. The world is split into square chunks, a chunk stays
+// resident while a moving particle is within ActivationRadius chunks of it or an area touching it was passed
+// to Touch. Resting particles lean on their neighbours across chunk borders, so a chunk also stays resident while
+// a particle of a chunk that stays resident can touch it. Chunks that stayed outside all of that for IdleUpdates
+// updates have their particles stored as ParticleRecords, in memory or in a file per chunk, and removed from the
+// ECS. They are built again as soon as activity comes back within range, so the ECS and the broadphase only ever
+// hold the active area and whatever it rests on.
+//
+// Particles move far less than a chunk per update, so a moving particle always pages its neighbours in before
+// it can reach them.
+template <typename TEcs>
+class WorldPager {
+public:
+    struct Config {
+        float ChunkSize = 100.0f;
+        int ActivationRadius = 1;
+        // Particles slower than this count as resting.
+        float RestSpeed = 0.5f;
+        int IdleUpdates = 60;
+        // How far past its own radius a particle can touch another one, the largest radius in the world.
+        float ContactDistance = circleRadius;
+        // Page out to files in this directory when set, otherwise keep the records in memory. Records that could
+        // not be written stay in memory and are written with the next page out, a chunk whose file could not be
+        // read stays paged out and is read again with the next Update that keeps it.
+        std::filesystem::path Directory{};
+        // Called before an Update adds or removes entities, for example to stop a background query rebuild that
+        // still reads the ECS.
+        std::function<void()> BeforeChange{};
+    };
+
+    WorldPager(TEcs& ecs, const WorldBoundrarys& worldBoundrarys, Config config)
+    : ecs(ecs)
+    , worldBoundrarys(worldBoundrarys)
+    , config(std::move(config))
+    , columns(std::max(1, static_cast<int>(std::ceil(worldBoundrarys.Size.x / this->config.ChunkSize))))
+    , rows(std::max(1, static_cast<int>(std::ceil(worldBoundrarys.Size.y / this->config.ChunkSize))))
+    , chunks(columns * rows)
+    , keep(columns * rows, 0)
+    , reach(columns * rows) {
+    }
+
+    // Keeps the chunks overlapping area resident through the next Update, for example the camera's view.
+    void Touch(const sf::FloatRect& area) {
+        const auto [minColumn, minRow] = ChunkOf({area.left, area.top});
+        const auto [maxColumn, maxRow] = ChunkOf({area.left + area.width, area.top + area.height});
+        for (int row = minRow; row <= maxRow; row++) {
+            for (int column = minColumn; column <= maxColumn; column++) {
+                keep[row * columns + column] = 1;
+            }
+        }
+    }
+
+    void Update() {
+        for (const auto& [verlet]: ecs.template GetSystem<Verlet>()) {
+            if (sf::getLength(verlet.Velocity) > config.RestSpeed) {
+                const auto [column, row] = ChunkOf(verlet.Position);
+                KeepAround(column, row);
+            }
+        }
+        KeepSupports();
+        for (size_t i = 0; i < chunks.size(); i++) {
+            auto& chunk = chunks[i];
+            if (keep[i]) {
+                chunk.IdleUpdates = 0;
+            } else if (chunk.Resident && ++chunk.IdleUpdates >= config.IdleUpdates) {
+                chunk.Resident = false;
+            }
+        }
+        PageOut();
+        std::fill(keep.begin(), keep.end(), 0);
+    }
+
+    [[nodiscard]] size_t GetResidentChunks() const {
+        return std::count_if(chunks.begin(), chunks.end(), [](const Chunk& chunk) { return chunk.Resident; });
+    }
+
+    [[nodiscard]] size_t GetPagedParticles() const {
+        return pagedParticles;
+    }
+
+    // Bytes of paged out records held in memory, zero when paging to files.
+    [[nodiscard]] size_t GetPagedBytes() const {
+        size_t bytes = 0;
+        for (const auto& chunk: chunks) {
+            bytes += chunk.Records.capacity() * sizeof(ParticleRecord);
+        }
+        return bytes;
+    }
+
+private:
+    struct Chunk {
+        bool Resident = true;
+        int IdleUpdates = 0;
+        // Records in the chunk's file.
+        size_t Written = 0;
+        // Records held in memory.
+        std::vector<ParticleRecord> Records;
+    };
+
+    std::pair<int, int> ChunkOf(sf::Vector2f position) const {
+        const auto local = (position - worldBoundrarys.Position) / config.ChunkSize;
+        return {std::clamp(static_cast<int>(std::floor(local.x)), 0, columns - 1),
+                std::clamp(static_cast<int>(std::floor(local.y)), 0, rows - 1)};
+    }
+
+    void KeepAround(int column, int row) {
+        const int radius = config.ActivationRadius;
+        for (int y = std::max(row - radius, 0); y <= std::min(row + radius, rows - 1); y++) {
+            for (int x = std::max(column - radius, 0); x <= std::min(column + radius, columns - 1); x++) {
+                keep[y * columns + x] = 1;
+            }
+        }
+    }
+
+    // Walks out from the kept chunks and keeps every chunk a particle of a kept chunk can touch, paging in the
+    // kept chunks that are not resident on the way so their particles are followed too.
+    void KeepSupports() {
+        for (auto& bounds: reach) {
+            bounds.clear();
+        }
+        for (const auto& [circle, verlet]: ecs.template GetSystem<Circle, Verlet>()) {
+            if (worldBoundrarys.GetBox().contains(verlet.Position)) {
+                const auto [column, row] = ChunkOf(verlet.Position);
+                reach[row * columns + column].push_back(ContactBounds(verlet.Position, circle.Radius));
+            }
+        }
+        std::vector<size_t> open;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            if (keep[i]) {
+                open.push_back(i);
+            }
+        }
+        while (!open.empty()) {
+            const size_t index = open.back();
+            open.pop_back();
+            if (!chunks[index].Resident && !PageIn(index)) {
+                continue;
+            }
+            for (const auto& bounds: reach[index]) {
+                const auto [minColumn, minRow] = ChunkOf({bounds.left, bounds.top});
+                const auto [maxColumn, maxRow] = ChunkOf({bounds.left + bounds.width, bounds.top + bounds.height});
+                for (int row = minRow; row <= maxRow; row++) {
+                    for (int column = minColumn; column <= maxColumn; column++) {
+                        const size_t touched = row * columns + column;
+                        if (!keep[touched]) {
+                            keep[touched] = 1;
+                            open.push_back(touched);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    sf::FloatRect ContactBounds(sf::Vector2f position, float radius) const {
+        const float extent = radius + config.ContactDistance;
+        return {position.x - extent, position.y - extent, 2 * extent, 2 * extent};
+    }
+
+    void NotifyChange() {
+        if (config.BeforeChange) {
+            config.BeforeChange();
+        }
+    }
+
+    // Moves the particles in non resident chunks out of the ECS. Particles outside the world are left to their
+    // owner, which removes them or parks them in a ParticlePool.
+    void PageOut() {
+        std::vector<ecs::EntityID> leaving;
+        for (const auto& [circle, verlet, id]: ecs.template GetSystem<Circle, Verlet, ecs::EntityID>()) {
+            if (!worldBoundrarys.GetBox().contains(verlet.Position)) {
+                continue;
+            }
+            const auto [column, row] = ChunkOf(verlet.Position);
+            auto& chunk = chunks[row * columns + column];
+            if (!chunk.Resident) {
+                chunk.Records.push_back(MakeParticleRecord(circle, verlet));
+                leaving.push_back(id);
+            }
+        }
+        if (!leaving.empty()) {
+            NotifyChange();
+            for (const auto& id: leaving) {
+                ecs.RemoveEntity(id);
+            }
+            pagedParticles += leaving.size();
+        }
+        // A resting particle can drift into a chunk that is already paged out, its record is appended.
+        for (size_t i = 0; i < chunks.size(); i++) {
+            auto& chunk = chunks[i];
+            if (chunk.Resident || chunk.Records.empty()) {
+                continue;
+            }
+            if (config.Directory.empty()) {
+                chunk.Records.shrink_to_fit();
+            } else if (WriteRecords(i)) {
+                chunk.Written += chunk.Records.size();
+                chunk.Records = {};
+            }
+        }
+    }
+
+    // Appends the chunk's records in memory to its file. A failed write is cut off again, so the file only ever
+    // holds whole, written records.
+    bool WriteRecords(size_t index) {
+        const auto& chunk = chunks[index];
+        std::ofstream file(ChunkPath(index), std::ios::binary | std::ios::app);
+        file.write(reinterpret_cast<const char*>(chunk.Records.data()),
+                   static_cast<std::streamsize>(chunk.Records.size() * sizeof(ParticleRecord)));
+        file.close();
+        if (file) {
+            return true;
+        }
+        std::error_code error;
+        if (chunk.Written == 0) {
+            std::filesystem::remove(ChunkPath(index), error);
+        } else {
+            std::filesystem::resize_file(ChunkPath(index), chunk.Written * sizeof(ParticleRecord), error);
+        }
+        return false;
+    }
+
+    // Builds the chunk's particles again and adds their reach, false when its file could not be read.
+    bool PageIn(size_t index) {
+        auto& chunk = chunks[index];
+        if (chunk.Written > 0) {
+            std::vector<ParticleRecord> written(chunk.Written);
+            std::ifstream file(ChunkPath(index), std::ios::binary);
+            file.read(reinterpret_cast<char*>(written.data()),
+                      static_cast<std::streamsize>(written.size() * sizeof(ParticleRecord)));
+            if (!file) {
+                return false;
+            }
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(ChunkPath(index), error);
+            chunk.Records.insert(chunk.Records.begin(), written.begin(), written.end());
+            chunk.Written = 0;
+        }
+        chunk.Resident = true;
+        if (chunk.Records.empty()) {
+            return true;
+        }
+        NotifyChange();
+        for (const auto& record: chunk.Records) {
+            BuildParticle(ecs, record);
+            reach[index].push_back(ContactBounds(record.Position, record.Radius));
+        }
+        pagedParticles -= chunk.Records.size();
+        chunk.Records = {};
+        return true;
+    }
+
+    std::filesystem::path ChunkPath(size_t index) const {
+        return config.Directory / ("chunk_" + std::to_string(index) + ".bin");
+    }
+
+    TEcs& ecs;
+    const WorldBoundrarys worldBoundrarys;
+    const Config config;
+    const int columns;
+    const int rows;
+    std::vector<Chunk> chunks;
+    std::vector<uint8_t> keep;
+    // Contact bounds of the particles of each chunk, rebuilt every Update.
+    std::vector<std::vector<sf::FloatRect>> reach;
+    size_t pagedParticles = 0;
+};
@@ -7,7 +7,16 @@
 #include "Physics.h"
 #include "Controls.h"
 #include "PhysimCpp.h"
+#include "Overlay.h"
+#include "Camera.h"
+#include "FrameScheduler.h"
+#include "WorldPager.h"
+#include "ParticlePool.h"
+#include "Autotuner.h"
 #include <SFMLMath.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
 
 void AddCircle(auto &ecs, auto &worldBoundrarys) {
     auto pos = sf::Vector2f{RandomFloat(20, worldBoundrarys.Size.x - 20), RandomFloat(20, worldBoundrarys.Size.y - 20)};
@@ -56,6 +65,58 @@ int main() {
 
     ECS ecs;
     PhysimCpp physimCpp(ecs, worldBoundrarys);
+
+    // Gravity and velocity integration run per chunk, so a chunk can integrate while gravity is still being
+    // applied to the next one.
+    constexpr int frameChunks = 4;
+    ThreadPool framePool(frameChunks);
+    FrameScheduler scheduler(framePool);
+    float frameDt = 0.0f;
+    // Circles leaving the world are recycled for the emitters added with E.
+    ParticlePool particlePool(ecs, worldBoundrarys);
+    scheduler.Add({.Name="emitters", .Writes=Components<Circle, Verlet, Emitter>(), .Run=[&]() {
+        particlePool.Emit(frameDt);
+    }});
+    for (int chunk = 0; chunk < frameChunks; chunk++) {
+        scheduler.Add({.Name="gravity", .Writes=Components<Verlet>(), .Chunk=chunk, .Run=[&, chunk]() {
+            GravitySystem::Run(GravitySystem::Config{.Ecs=ecs, .dt=frameDt, .Part=chunk, .NrParts=frameChunks});
+        }});
+    }
+    physimCpp.AddTasks(scheduler, frameDt, frameChunks);
+
+    PerformanceOverlay overlay;
+    bool showOverlay = false;
+    Camera camera(worldBoundrarys, sfmlWin.getSize());
+    DensityLayer densityLayer;
+    // Paging adds and removes circles, which a background query rebuild must not see half done.
+    WorldPager pager(ecs, worldBoundrarys, {.BeforeChange=[&physimCpp]() { physimCpp.InvalidateQuery(); }});
+    // Set PHYSIM_TUNED to a file name to tune the physics config over the first frames after all circles are
+    // added and save the result there, later runs with the same file load it instead of tuning again.
+    std::filesystem::path tunedConfigPath;
+    std::optional<Autotuner> autotuner;
+    if (const char *tunedName = std::getenv("PHYSIM_TUNED")) {
+        tunedConfigPath = tunedName;
+        if (const auto tuned = LoadTunedConfig(tunedConfigPath, physimCpp.GetConfig())) {
+            physimCpp.SetConfig(*tuned);
+        } else {
+            autotuner.emplace(physimCpp.GetConfig());
+        }
+    }
+#ifdef PHYSIM_STATE_EXPORT
+    // Set PHYSIM_EXPORT to a shared memory name such as /physim-cpp to let other processes follow the simulation
+    // with a StateExportReader of that name.
+    std::optional<StateExporter> stateExporter;
+    if (const char *exportName = std::getenv("PHYSIM_EXPORT")) {
+        try {
+            stateExporter.emplace(exportName, 2 * nrCircles);
+            physimCpp.SetExporter(&*stateExporter);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << ", running without state export" << std::endl;
+        }
+    }
+#endif
+    std::optional<sf::Vector2i> dragStart;
+    MemoryAccount renderMemory;
     Controls controls;
     controls.RegisterEvent(sf::Event::Closed, [&sfmlWin](auto) { sfmlWin.close(); });
     controls.RegisterEvent(sf::Event::KeyPressed, [&](auto e) {
@@ -63,6 +124,22 @@ int main() {
             pause = !pause;
         } else if (e.key.code == sf::Keyboard::Right) {
             step = true;
+        } else if (e.key.code == sf::Keyboard::O) {
+            showOverlay = !showOverlay;
+            auto config = physimCpp.GetConfig();
+            config.CollectSnapshot = showOverlay;
+            physimCpp.SetConfig(config);
+        } else if (e.key.code == sf::Keyboard::H) {
+            overlay.ToggleHeatMap();
+        } else if (e.key.code == sf::Keyboard::E) {
+            const sf::Vector2f center{worldBoundrarys.Size.x / 2, 20.0f};
+            ecs.BuildEntity(Emitter{.Rate=200.0f, .Region={center - sf::Vector2f{50, 5}, {100, 10}},
+                                    .Velocity={0, 20}, .Spread={10, 5},
+                                    .Particle={.Radius=circleRadius, .Color=RandomColor()}});
+        } else if (e.key.code == sf::Keyboard::M) {
+            auto report = physimCpp.GetMemoryReport();
+            report.push_back(GetUsage("render vertices", renderMemory, true));
+            PrintMemoryReport(std::cout, report);
         }
     });
 
@@ -71,7 +148,10 @@ int main() {
 
     controls.RegisterEvent(sf::Event::MouseButtonPressed, [&](auto e) {
         if (e.mouseButton.button == sf::Mouse::Left) {
-            newLine.Start = sf::Vector2f{static_cast<float>(e.mouseButton.x), static_cast<float>(e.mouseButton.y)};
+            newLine.Start = camera.ToWorld({e.mouseButton.x, e.mouseButton.y});
+        }
+        if (e.mouseButton.button == sf::Mouse::Middle) {
+            dragStart = sf::Vector2i{e.mouseButton.x, e.mouseButton.y};
         }
         if (e.mouseButton.button == sf::Mouse::Right) {
             if (hoveredId) {
@@ -83,14 +163,29 @@ int main() {
     });
 
     controls.RegisterEvent(sf::Event::MouseButtonReleased, [&](auto e) {
+        if (e.mouseButton.button == sf::Mouse::Middle) {
+            dragStart = std::nullopt;
+        }
         if (e.mouseButton.button == sf::Mouse::Left) {
-            newLine.End = sf::Vector2f{static_cast<float>(e.mouseButton.x), static_cast<float>(e.mouseButton.y)};
+            newLine.End = camera.ToWorld({e.mouseButton.x, e.mouseButton.y});
             newLine.Normal = sf::normalBetweenPoints(newLine.Start, newLine.End);
             ecs.BuildEntity(Line{newLine});
         }
     });
+    controls.RegisterEvent(sf::Event::MouseWheelScrolled, [&](auto e) {
+        camera.Zoom(std::pow(1.1f, e.mouseWheelScroll.delta), {e.mouseWheelScroll.x, e.mouseWheelScroll.y});
+    });
+    controls.RegisterEvent(sf::Event::Resized, [&](auto e) {
+        camera.Resize({e.size.width, e.size.height});
+        sfmlWin.setView(sf::View(sf::FloatRect(0, 0, e.size.width, e.size.height)));
+    });
     controls.RegisterEvent(sf::Event::MouseMoved, [&](auto e) {
-        auto pos = sf::Vector2f{static_cast<float>(e.mouseMove.x), static_cast<float>(e.mouseMove.y)};
+        if (dragStart) {
+            camera.Pan(sf::Vector2f{static_cast<float>(e.mouseMove.x - dragStart->x),
+                                    static_cast<float>(e.mouseMove.y - dragStart->y)});
+            dragStart = sf::Vector2i{e.mouseMove.x, e.mouseMove.y};
+        }
+        auto pos = camera.ToWorld({e.mouseMove.x, e.mouseMove.y});
         hoveredId = ecs::EntityID();
         for (const auto &[id, circle, verlet]: ecs.template GetSystem<ecs::EntityID, Circle, Verlet>()) {
             if (sf::distance(pos, verlet.Position) < circle.Radius) {
@@ -115,6 +210,8 @@ int main() {
     nrPoints.setPosition(10, 50);
 
     sf::Clock clock;
+    sf::Clock renderClock;
+    double renderTime = 0.0;
     auto fps = std::to_string(1);
     bool doneAddingCircles = false;
     while (sfmlWin.isOpen()) {
@@ -125,6 +222,7 @@ int main() {
             dt = 1/60.0f;
         }
         if (!doneAddingCircles){
+            physimCpp.InvalidateQuery();
             for (int i = 0; i < 50 && ecs.Size() < nrCircles; i++) {
                 AddCircle(ecs, worldBoundrarys);
                 pause = true;
@@ -140,13 +238,29 @@ int main() {
                 fps = "Done adding circles";
             } else {
                 fps = std::to_string(1 / dt);
-                GravitySystem::Run(GravitySystem::Config{
-                        .Ecs=ecs,
-                        .dt=dt
-                });
-                physimCpp.Run(dt);
+                frameDt = dt;
+                scheduler.Run();
+                pager.Touch(camera.GetVisibleArea());
+                pager.Update();
+                if (autotuner && doneAddingCircles) {
+                    auto config = autotuner->Update(physimCpp.GetStats());
+                    config.CollectSnapshot = physimCpp.GetConfig().CollectSnapshot;
+                    physimCpp.SetConfig(config);
+                    if (autotuner->IsDone()) {
+                        autotuner->Report(std::cout);
+                        if (!SaveTunedConfig(tunedConfigPath, *autotuner)) {
+                            std::cerr << "Could not save the tuned config to " << tunedConfigPath << std::endl;
+                        }
+                        autotuner.reset();
+                    }
+                }
             }
         }
+        if (showOverlay) {
+            overlay.Push(physimCpp.GetStats(), renderTime);
+            overlay.SetSnapshot(physimCpp.GetBroadphaseSnapshot());
+        }
+        renderClock.restart();
         RenderSystem::Run(RenderSystem::Config{
                 .FpsText=fps,
                 .Window=sfmlWin,
@@ -155,8 +269,15 @@ int main() {
                 .Ecs=ecs,
                 .worldBoundrarys=worldBoundrarys,
                 .hoveredId=selected.value_or(hoveredId),
-                .lines=lines
+                .lines=lines,
+                .QueryRadius=physimCpp.GetConfig().QueryRadius,
+                .Overlay=showOverlay ? &overlay : nullptr,
+                .Viewport=&camera,
+                .Lod=&densityLayer,
+                .VertexMemory=&renderMemory,
+                .Pool=&particlePool
         });
+        renderTime = renderClock.getElapsedTime().asSeconds();
         if (step) {
             pause = true;
             step = false;
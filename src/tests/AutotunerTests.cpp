@@ -0,0 +1,47 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../Autotuner.h"
+
+TEST(AutotunerTests, AutotunerPicksFastestConfig) {
+    const PhysimConfig base{.QueryParts=2};
+    Autotuner tuner(base, {.WarmupFrames=1, .MeasuredFrames=5, .MinIterations=1});
+    auto config = base;
+    int frames = 0;
+    while (!tuner.IsDone()) {
+        PhysimStats stats;
+        stats.SolveTime = std::abs(config.QueryParts - 8) + std::abs(static_cast<int>(config.LeafSize) - 32) * 0.1 +
+                          config.QueryRadius + config.NrIterations * 0.5;
+        config = tuner.Update(stats);
+        frames++;
+    }
+    ASSERT_EQ(frames, tuner.GetTotalFrames());
+    ASSERT_EQ(tuner.GetBest().QueryParts, 8);
+    ASSERT_EQ(tuner.GetBest().LeafSize, 32);
+    ASSERT_EQ(tuner.GetBest().QueryRadius, base.QueryRadius);
+    ASSERT_EQ(tuner.GetBest().NrIterations, 1);
+
+    const auto path = uniqueTempPath("physim-tuned-").replace_extension(".txt");
+    ASSERT_TRUE(SaveTunedConfig(path, tuner));
+    // Skin was not tuned, so the file leaves it alone.
+    const auto loaded = LoadTunedConfig(path, PhysimConfig{.RecordContacts=true, .Skin=2.0f});
+    std::filesystem::remove(path);
+    ASSERT_TRUE(loaded);
+    ASSERT_EQ(loaded->QueryParts, 8);
+    ASSERT_EQ(loaded->LeafSize, 32);
+    ASSERT_EQ(loaded->NrIterations, 1);
+    ASSERT_EQ(loaded->Skin, 2.0f);
+    ASSERT_TRUE(loaded->RecordContacts);
+    ASSERT_FALSE(LoadTunedConfig(path, base));
+}
+
+TEST(AutotunerTests, AutotunerCountsAsyncRebuilds) {
+    Autotuner tuner(PhysimConfig{.AsyncQuery=true}, {.WarmupFrames=0, .MeasuredFrames=1});
+    auto config = tuner.GetBest();
+    while (!tuner.IsDone()) {
+        // The background rebuild is the only cost that depends on the leaf size.
+        PhysimStats stats;
+        stats.RebuildTime = std::abs(static_cast<int>(config.LeafSize) - 16);
+        config = tuner.Update(stats);
+    }
+    ASSERT_EQ(tuner.GetBest().LeafSize, 16);
+}
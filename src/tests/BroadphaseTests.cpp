@@ -0,0 +1,114 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../HierarchicalGrid.h"
+#include "../Quadtree.h"
+#include <random>
+
+TEST(BroadphaseTests, HierarchicalGridMatchesBruteForce) {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> coordinate(0.0f, 200.0f);
+    std::uniform_real_distribution<float> grain(0.5f, 1.5f);
+    TestEcs ecs;
+    for (int i = 0; i < 500; i++) {
+        sf::Vector2f pos{coordinate(gen), coordinate(gen)};
+        const float radius = i % 50 == 0 ? 20.0f : grain(gen);
+        ecs.BuildEntity(Circle{.Radius=radius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+    }
+    HierarchicalGridBroadphase grid;
+    grid.Build(ecs, WorldBoundrarys{{0, 0}, {200, 200}});
+    ASSERT_GT(grid.GetNrLevels(), 1);
+
+    const float margin = 0.5f;
+    for (const auto &[circle, verlet, id]: ecs.GetSystem<Circle, Verlet, ecs::EntityID>()) {
+        octreeQuery result;
+        grid.Query(circle, verlet, margin, result, *std::pmr::get_default_resource());
+        std::vector<size_t> found;
+        for (const auto &neighbour: result) {
+            found.push_back(neighbour.Data.GetId());
+        }
+        std::vector<size_t> expected;
+        for (const auto &[circle2, verlet2, id2]: ecs.GetSystem<Circle, Verlet, ecs::EntityID>()) {
+            if (sf::distance(verlet.Position, verlet2.Position) <= circle.Radius + circle2.Radius + margin) {
+                expected.push_back(id2.GetId());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(found, expected);
+    }
+}
+
+TEST(BroadphaseTests, QuadtreeQueriesMatchBruteForce) {
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> coordinate(0.0f, 200.0f);
+    std::uniform_real_distribution<float> radius(0.0f, 15.0f);
+    std::vector<sf::Vector2f> points;
+    for (int i = 0; i < 1000; i++) {
+        points.push_back(i < 40 ? sf::Vector2f{100, 100} : sf::Vector2f{coordinate(gen), coordinate(gen)});
+    }
+    Quadtree<size_t> tree;
+    for (size_t i = 0; i < points.size(); i++) {
+        tree.Add({points[i], i});
+    }
+    tree.Build({0, 0, 200, 200});
+    ASSERT_EQ(tree.Size(), points.size());
+
+    std::vector<QuadtreeQuery> queries;
+    for (int i = 0; i < 200; i++) {
+        queries.push_back({{coordinate(gen), coordinate(gen)}, radius(gen)});
+    }
+    queries.push_back({{100, 100}, 0.0f});
+    FrameArena arena;
+    std::vector<std::vector<size_t>> batched(queries.size());
+    tree.QueryBatch(queries, [&](size_t query, const auto &item) { batched[query].push_back(item.Data); }, arena);
+    for (size_t query = 0; query < queries.size(); query++) {
+        std::vector<size_t> found;
+        tree.Query(queries[query], [&](const auto &item) { found.push_back(item.Data); });
+        ASSERT_EQ(found, batched[query]);
+        std::vector<DataWrapper<sf::Vector2f, size_t>> written;
+        tree.QueryInto(queries[query], std::back_inserter(written));
+        ASSERT_EQ(written.size(), found.size());
+
+        std::vector<size_t> expected;
+        for (size_t i = 0; i < points.size(); i++) {
+            const auto delta = points[i] - queries[query].Center;
+            if (delta.x * delta.x + delta.y * delta.y <= queries[query].Radius * queries[query].Radius) {
+                expected.push_back(i);
+            }
+        }
+        std::sort(found.begin(), found.end());
+        ASSERT_EQ(found, expected);
+    }
+    ASSERT_EQ(batched.back().size(), 40);
+}
+
+TEST(BroadphaseTests, QuadtreeParallelBuildMatchesSerial) {
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> coordinate(0.0f, 1000.0f);
+    Quadtree<size_t> serial;
+    Quadtree<size_t> parallel;
+    for (size_t i = 0; i < 20000; i++) {
+        const sf::Vector2f position{coordinate(gen), i % 3 == 0 ? coordinate(gen) / 10.0f : coordinate(gen)};
+        serial.Add({position, i});
+        parallel.Add({position, i});
+    }
+    ThreadPool pool(4);
+    serial.Build({0, 0, 1000, 1000});
+    parallel.Build({0, 0, 1000, 1000}, &pool);
+
+    std::vector<std::pair<sf::Vector2f, sf::Vector2f>> serialLeaves;
+    serial.ForEachLeaf([&](const auto &min, const auto &max) { serialLeaves.emplace_back(min, max); });
+    std::vector<std::pair<sf::Vector2f, sf::Vector2f>> parallelLeaves;
+    parallel.ForEachLeaf([&](const auto &min, const auto &max) { parallelLeaves.emplace_back(min, max); });
+    ASSERT_GT(serialLeaves.size(), 64);
+    ASSERT_EQ(serialLeaves.size(), parallelLeaves.size());
+
+    for (int i = 0; i < 100; i++) {
+        const QuadtreeQuery query{{coordinate(gen), coordinate(gen)}, 20.0f};
+        std::vector<size_t> expected;
+        serial.Query(query, [&](const auto &item) { expected.push_back(item.Data); });
+        std::vector<size_t> found;
+        parallel.Query(query, [&](const auto &item) { found.push_back(item.Data); });
+        ASSERT_EQ(found, expected);
+    }
+}
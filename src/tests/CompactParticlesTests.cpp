@@ -0,0 +1,80 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../CompactParticles.h"
+
+TEST(CompactParticlesTests, HalfPrecisionRoundTrip) {
+    ASSERT_EQ(ToHalf(1.0f), 0x3c00);
+    ASSERT_EQ(ToHalf(-2.0f), 0xc000);
+    ASSERT_EQ(ToHalf(65504.0f), 0x7bff);
+    ASSERT_EQ(ToHalf(1e6f), 0x7c00);
+    ASSERT_EQ(FromHalf(0x0001), std::ldexp(1.0f, -24));
+    for (const float value: {0.0f, 0.1f, -3.7f, 99.9f, 1e-3f, -12345.0f}) {
+        ASSERT_NEAR(FromHalf(ToHalf(value)), value, std::abs(value) * 1e-3f + 1e-7f);
+    }
+}
+
+TEST(CompactParticlesTests, CompactParticlesRoundTripAndCollide) {
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {100, 100}};
+    TestEcs ecs;
+    addTestCircles(ecs, 2.5f);
+    CompactParticles previous(worldBoundrarys, {.KeepPrevious=true});
+    previous.Pack(ecs);
+    ASSERT_EQ(previous.Size(), 100);
+    ASSERT_EQ(previous.GetPalette().size(), 1);
+    ASSERT_EQ(previous.GetBytesPerParticle(), 24);
+    size_t i = 0;
+    for (const auto &[circle, verlet]: ecs.GetSystem<Circle, Verlet>()) {
+        const auto record = previous.Get(i++);
+        ASSERT_LT(sf::distance(record.Position, verlet.Position), 1e-3f);
+        ASSERT_LT(sf::distance(record.PreviousPosition, verlet.PreviousPosition), 1e-3f);
+        ASSERT_LT(sf::distance(record.Velocity, verlet.Velocity), 1e-2f);
+        ASSERT_EQ(record.Radius, circle.Radius);
+    }
+    TestEcs unpacked;
+    previous.Unpack(unpacked);
+    ASSERT_EQ(unpacked.Size(), 100);
+
+    // A pile dropped into the box settles without circles passing through each other or the walls.
+    CompactParticles compact(worldBoundrarys, {.NrIterations=4});
+    ASSERT_EQ(compact.GetBytesPerParticle(), 20);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> coordinate(10.0f, 90.0f);
+    for (int particle = 0; particle < 400; particle++) {
+        const sf::Vector2f pos{coordinate(gen), coordinate(gen)};
+        ASSERT_TRUE(compact.Add({.Position=pos, .Velocity={0, 0}, .PreviousPosition=pos, .Radius=circleRadius,
+                                 .Bounciness=0.5f, .Color=particle % 2 ? 0xff0000ffu : 0x00ff00ffu}));
+    }
+    ASSERT_EQ(compact.GetPalette().size(), 2);
+    for (int frame = 0; frame < 300; frame++) {
+        compact.Accelerate({0, 100}, 0.01f);
+        compact.Run(0.01f);
+    }
+    float worstOverlap = 0.0f;
+    float meanHeight = 0.0f;
+    for (size_t a = 0; a < compact.Size(); a++) {
+        const auto position = compact.GetPosition(a);
+        meanHeight += position.y / static_cast<float>(compact.Size());
+        ASSERT_TRUE(worldBoundrarys.GetBox().contains(position));
+        for (size_t b = a + 1; b < compact.Size(); b++) {
+            worstOverlap = std::max(worstOverlap, 2 * circleRadius - sf::distance(position, compact.GetPosition(b)));
+        }
+    }
+    ASSERT_LT(worstOverlap, 0.5f * circleRadius);
+    ASSERT_GT(meanHeight, 75.0f);
+    ASSERT_FALSE(compact.Add({.Radius=2.5f * circleRadius}));
+}
+
+TEST(CompactParticlesTests, CompactParticlesApplyFriction) {
+    auto slidingAfterContact = [](float friction) {
+        CompactParticles compact(WorldBoundrarys{{0, 0}, {100, 100}}, {.NrIterations=1});
+        compact.Add({.Position={50, 50}, .Velocity={0, 0}, .PreviousPosition={50, 50}, .Radius=circleRadius,
+                     .Friction=friction});
+        compact.Add({.Position={52.9f, 50}, .Velocity={-10, 20}, .PreviousPosition={52.9f, 50},
+                     .Radius=circleRadius, .Friction=friction});
+        compact.Run(0.001f);
+        return compact.Get(1).Velocity.y - compact.Get(0).Velocity.y;
+    };
+    ASSERT_NEAR(slidingAfterContact(0.0f), 20.0f, 0.1f);
+    // The normal impulse is about 5, friction takes out at most as much of the tangential impulse.
+    ASSERT_NEAR(slidingAfterContact(1.0f), 10.0f, 0.5f);
+}
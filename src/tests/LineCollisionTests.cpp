@@ -0,0 +1,134 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../Physics.h"
+#include "../PhysimCpp.h"
+#include "../LineDistanceField.h"
+#include <random>
+
+TEST(LineCollisionTests, SegmentPacketMatchesScalar) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> coordinate(0.0f, 50.0f);
+    std::uniform_real_distribution<float> step(-5.0f, 5.0f);
+    const auto randomPoint = [&]() { return sf::Vector2f{coordinate(gen), coordinate(gen)}; };
+
+    for (int round = 0; round < 200; round++) {
+        std::vector<Line> lines;
+        for (int i = 0; i < 2 * segmentPacketWidth + 3; i++) {
+            lines.push_back(Line{randomPoint(), randomPoint()});
+        }
+        lines.push_back(Line{{10, 10}, {10, 10}});
+        TrackedVector<SegmentPacket> packets;
+        PackSegments(lines, packets);
+        ASSERT_EQ(packets.size(), 3);
+
+        Verlet verlet;
+        verlet.PreviousPosition = randomPoint();
+        verlet.Position = round % 4 == 0 ? verlet.PreviousPosition : verlet.PreviousPosition + sf::Vector2f{step(gen), step(gen)};
+        const float radius = 1.5f;
+        for (size_t i = 0; i < lines.size(); i++) {
+            const auto &packet = packets[i / segmentPacketWidth];
+            const auto hits = IntersectMovingCircleSegments(radius, verlet.PreviousPosition, verlet.Position, packet);
+            const auto distance = SegmentSegmentDistance(verlet.PreviousPosition, verlet.Position, lines[i].Start, lines[i].End);
+            if (std::abs(distance - radius * radius) < 1e-3) {
+                continue;
+            }
+            ASSERT_EQ(((hits >> (i % segmentPacketWidth)) & 1u) == 1u, IntersectMovingCircleLine(radius, verlet, lines[i]));
+        }
+    }
+}
+
+TEST(LineCollisionTests, SegmentPacketCrossing) {
+    std::vector<Line> lines = {
+            Line{{0, 5}, {10, 5}},
+            Line{{0, 20}, {10, 20}},
+            Line{{5, 0}, {5, 10}},
+    };
+    TrackedVector<SegmentPacket> packets;
+    PackSegments(lines, packets);
+    ASSERT_EQ(packets.size(), 1);
+    ASSERT_EQ(packets[0].Count, 3);
+
+    ASSERT_EQ(IntersectMovingCircleSegments(0.1f, {2, 0}, {2, 10}, packets[0]), 0b001u);
+    ASSERT_EQ(IntersectMovingCircleSegments(1.0f, {5, 19.5f}, {5, 19.5f}, packets[0]), 0b010u);
+    ASSERT_EQ(IntersectMovingCircleSegments(0.1f, {0, 0}, {10, 10}, packets[0]), 0b101u);
+    ASSERT_EQ(IntersectMovingCircleSegments(0.1f, {20, 20}, {30, 30}, packets[0]), 0u);
+}
+
+TEST(LineCollisionTests, LineDistanceFieldMatchesSegments) {
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> coordinate(0.0f, 100.0f);
+    std::vector<Line> lines;
+    for (int i = 0; i < 20; i++) {
+        const sf::Vector2f start{coordinate(gen), coordinate(gen)};
+        const sf::Vector2f end{coordinate(gen), coordinate(gen)};
+        lines.push_back(Line{start, end, sf::normalBetweenPoints(start, end)});
+    }
+    const float cellSize = 0.25f;
+    const float range = 6.0f;
+    LineDistanceField field;
+    field.Bake(lines, {0, 0, 100, 100}, cellSize, range);
+
+    auto signedDistance = [&](sf::Vector2f position) {
+        float expected = range;
+        for (const auto &line: lines) {
+            const auto segment = line.End - line.Start;
+            const auto fromStart = position - line.Start;
+            const float t = std::clamp((fromStart.x * segment.x + fromStart.y * segment.y) /
+                                       (segment.x * segment.x + segment.y * segment.y), 0.0f, 1.0f);
+            const auto offset = fromStart - segment * t;
+            if (sf::getLength(offset) < std::abs(expected)) {
+                const bool behind = t > 0.0f && t < 1.0f && offset.x * line.Normal.x + offset.y * line.Normal.y > 0.0f;
+                expected = behind ? -sf::getLength(offset) : sf::getLength(offset);
+            }
+        }
+        return expected;
+    };
+    for (int i = 0; i < 2000; i++) {
+        const sf::Vector2f position{coordinate(gen), coordinate(gen)};
+        const float expected = signedDistance(position);
+        // Where the sign flips between the nodes around a position, behind a line or where lines cross, the
+        // interpolation blends both sides.
+        bool flips = false;
+        for (const sf::Vector2f corner: {sf::Vector2f{-1, -1}, sf::Vector2f{-1, 1}, sf::Vector2f{1, -1}, sf::Vector2f{1, 1}}) {
+            flips |= (signedDistance(position + corner * cellSize) < 0) != (expected < 0);
+        }
+        const auto sample = field.At(position);
+        if (!flips) {
+            ASSERT_NEAR(sample.Distance, expected, cellSize);
+        }
+        if (std::abs(expected) < range - cellSize) {
+            ASSERT_NE(sample.Line, LineDistanceField::noLine);
+            ASSERT_NEAR(sf::getLength(sample.Direction), 1.0f, 1e-4);
+        }
+    }
+    ASSERT_EQ(field.At({-50, -50}).Distance, range);
+}
+
+TEST(LineCollisionTests, LineFieldCollisionKeepsCirclesAbove) {
+    TestEcs ecs;
+    sf::Vector2f pos{50, 40};
+    const auto id = ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+    const auto lineId = ecs.BuildEntity(Line{{10, 50}, {90, 50}, {0, 1}});
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}},
+                     PhysimConfig{.NrThreads=1, .AsyncQuery=false, .LineFieldCellSize=0.5f});
+    float lowest = pos.y;
+    for (int frame = 0; frame < 300; frame++) {
+        ecs.Get<Verlet>(id).Acceleration = {0, 100};
+        physim.Run(0.01f);
+        lowest = std::max(lowest, ecs.Get<Verlet>(id).Position.y);
+        ASSERT_LT(ecs.Get<Verlet>(id).Position.y, 50.0f - 0.5f * circleRadius);
+    }
+    ASSERT_GT(lowest, 50.0f - circleRadius - 0.5f);
+    ASSERT_EQ(physim.GetStats().LineFieldBakes, 1);
+
+    ecs.Get<Line>(lineId).End = {90, 45};
+    physim.Run(0.01f);
+    ASSERT_EQ(physim.GetStats().LineFieldBakes, 2);
+
+    // A circle whose center has crossed the line goes back to the free side instead of out the far side.
+    ecs.Get<Line>(lineId).End = {90, 50};
+    auto &verlet = ecs.Get<Verlet>(id);
+    verlet = Verlet{{50, 50.5f}, {0, 0}, {0, 0}, {50, 50.5f}};
+    physim.Run(0.01f);
+    ASSERT_LT(ecs.Get<Verlet>(id).Position.y, 50.0f);
+}
@@ -0,0 +1,168 @@
+#include "../Physics.h"
+#include "../PhysimCpp.h"
+#include "../CompactParticles.h"
+#include "Util.h"
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace {
+
+void addCircles(ECS &ecs, const WorldBoundrarys &worldBoundrarys, int count) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> x(0.0f, worldBoundrarys.Size.x);
+    std::uniform_real_distribution<float> y(0.0f, worldBoundrarys.Size.y);
+    std::uniform_real_distribution<float> velocity(-10.0f, 10.0f);
+    for (int i = 0; i < count; i++) {
+        sf::Vector2f pos{x(gen), y(gen)};
+        ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {velocity(gen), velocity(gen)}, pos},
+                        octreeQuery{});
+    }
+}
+
+const WorldBoundrarys worldBoundrarys{{0, 0}, {1200, 700}};
+
+}
+
+static void BM_OverlappPositions(benchmark::State &state) {
+    sf::Vector2f a{10, 10};
+    sf::Vector2f b{11, 12};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Overlapp(a, b, circleRadius, circleRadius));
+    }
+}
+BENCHMARK(BM_OverlappPositions);
+
+static void BM_OverlappLine(benchmark::State &state) {
+    Line line{{0, 0}, {100, 0}, sf::normalBetweenPoints({0, 0}, {100, 0})};
+    sf::Vector2f position{50, 1};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Overlapp(line, position, circleRadius));
+    }
+}
+BENCHMARK(BM_OverlappLine);
+
+static void BM_OverlappCircleShape(benchmark::State &state) {
+    sf::CircleShape a(circleRadius);
+    sf::CircleShape b(circleRadius);
+    b.setPosition({2, 1});
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Overlapp(a, b));
+    }
+}
+BENCHMARK(BM_OverlappCircleShape);
+
+static void BM_UpdateCircleVelocity(benchmark::State &state) {
+    Verlet a{.Position={0, 0}, .Velocity={0, 1}};
+    Verlet b{.Position={1, 2}, .Velocity={0, -1}};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(UpdateCircleVelocity(a, b));
+    }
+}
+BENCHMARK(BM_UpdateCircleVelocity);
+
+static void BM_IntersectMovingCircleLine(benchmark::State &state) {
+    Verlet verlet{.Position={50, 2}, .PreviousPosition={48, 5}};
+    Line line{{0, 0}, {100, 0}, sf::normalBetweenPoints({0, 0}, {100, 0})};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(IntersectMovingCircleLine(circleRadius, verlet, line));
+    }
+}
+BENCHMARK(BM_IntersectMovingCircleLine);
+
+static void BM_IntersectMovingCircleSegments(benchmark::State &state) {
+    std::vector<Line> lines;
+    for (int i = 0; i < segmentPacketWidth; i++) {
+        lines.push_back(Line{{0, i * 10.0f}, {100, i * 10.0f + 5}, {0, 1}});
+    }
+    TrackedVector<SegmentPacket> packets;
+    PackSegments(lines, packets);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(IntersectMovingCircleSegments(circleRadius, {48, 5}, {50, 2}, packets[0]));
+    }
+    state.SetItemsProcessed(state.iterations() * segmentPacketWidth);
+}
+BENCHMARK(BM_IntersectMovingCircleSegments);
+
+static void BM_SegmentSegmentDistance(benchmark::State &state) {
+    sf::Vector2f a{0, 0};
+    sf::Vector2f b{10, 3};
+    sf::Vector2f c{2, 5};
+    sf::Vector2f d{8, 7};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(SegmentSegmentDistance(a, b, c, d));
+    }
+}
+BENCHMARK(BM_SegmentSegmentDistance);
+
+static void BM_MakeOctree(benchmark::State &state) {
+    ECS ecs;
+    addCircles(ecs, worldBoundrarys, static_cast<int>(state.range(0)));
+    for (auto _: state) {
+        auto octree = MakeOctree(ecs, worldBoundrarys);
+        benchmark::DoNotOptimize(octree);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MakeOctree)->Arg(1000)->Arg(10000)->Arg(40000)->Unit(benchmark::kMillisecond);
+
+static void BM_OctreeQuery(benchmark::State &state) {
+    ECS ecs;
+    addCircles(ecs, worldBoundrarys, 40000);
+    auto octree = MakeOctree(ecs, worldBoundrarys);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(octree.Query(Octree::Circle{{600, 350}, circleRadius + queryRadius}));
+    }
+}
+BENCHMARK(BM_OctreeQuery);
+
+static void BM_QuadtreeQuery(benchmark::State &state) {
+    ECS ecs;
+    addCircles(ecs, worldBoundrarys, 40000);
+    OctreeBroadphase broadphase;
+    broadphase.Build(ecs, worldBoundrarys);
+    octreeQuery result;
+    for (auto _: state) {
+        result.clear();
+        broadphase.tree.QueryInto({{600, 350}, circleRadius + queryRadius}, std::back_inserter(result));
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+BENCHMARK(BM_QuadtreeQuery);
+
+static void BM_QuadtreeBuild(benchmark::State &state) {
+    ECS ecs;
+    addCircles(ecs, worldBoundrarys, static_cast<int>(state.range(0)));
+    ThreadPool pool(std::thread::hardware_concurrency());
+    OctreeBroadphase broadphase;
+    for (auto _: state) {
+        broadphase.Build(ecs, worldBoundrarys, state.range(1) ? &pool : nullptr);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_QuadtreeBuild)->ArgsProduct({{10000, 40000, 100000}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+static void BM_PhysimRun(benchmark::State &state) {
+    ECS ecs;
+    addCircles(ecs, worldBoundrarys, static_cast<int>(state.range(0)));
+    PhysimCpp physim(ecs, worldBoundrarys, PhysimConfig{.AsyncQuery=false});
+    for (auto _: state) {
+        physim.Run(1 / 60.0f);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PhysimRun)->Arg(10000)->Arg(40000)->Unit(benchmark::kMillisecond);
+
+static void BM_CompactRun(benchmark::State &state) {
+    ECS ecs;
+    addCircles(ecs, worldBoundrarys, static_cast<int>(state.range(0)));
+    CompactParticles compact(worldBoundrarys);
+    compact.Pack(ecs);
+    for (auto _: state) {
+        compact.Run(1 / 60.0f);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["BytesPerParticle"] = static_cast<double>(compact.GetBytesPerParticle());
+}
+BENCHMARK(BM_CompactRun)->Arg(10000)->Arg(40000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
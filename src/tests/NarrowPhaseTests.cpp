@@ -0,0 +1,124 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../PhysimCpp.h"
+#include "../ContactSolver.h"
+#include "../PairwiseNarrowPhase.h"
+#include <array>
+
+namespace {
+
+template<typename TNarrowPhase>
+float restingPairJitter(TestEcs &ecs) {
+    sf::Vector2f pos1{50, 50};
+    sf::Vector2f pos2{52.9f, 50};
+    const auto id1 = ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos1, {0, 0}, {0, 0}, pos1}, octreeQuery{});
+    const auto id2 = ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos2, {0, 0}, {0, 0}, pos2}, octreeQuery{});
+    PhysimCpp<TestEcs, OctreeBroadphase, TNarrowPhase> physim(
+            ecs, WorldBoundrarys{{0, 0}, {100, 100}}, PhysimConfig{.NrIterations=2, .NrThreads=1, .AsyncQuery=false});
+    float jitter = 0.0f;
+    for (int frame = 0; frame < 300; frame++) {
+        ecs.Get<Verlet>(id1).Acceleration = {20, 0};
+        ecs.Get<Verlet>(id2).Acceleration = {-20, 0};
+        physim.Run(0.01f);
+        if (frame >= 200) {
+            jitter += sf::getLength(ecs.Get<Verlet>(id1).Velocity) + sf::getLength(ecs.Get<Verlet>(id2).Velocity);
+        }
+    }
+    const auto distance = sf::distance(ecs.Get<Verlet>(id1).Position, ecs.Get<Verlet>(id2).Position);
+    EXPECT_GT(distance, 2 * circleRadius - 0.1f);
+    return jitter;
+}
+
+}
+
+TEST(NarrowPhaseTests, WarmStartedPairSettles) {
+    TestEcs averaged;
+    const auto averagedJitter = restingPairJitter<AveragedNarrowPhase>(averaged);
+    TestEcs warmStarted;
+    const auto warmStartedJitter = restingPairJitter<WarmStartedNarrowPhase>(warmStarted);
+    ASSERT_LT(warmStartedJitter, averagedJitter);
+    ASSERT_LT(warmStartedJitter, 1.0f);
+}
+
+TEST(NarrowPhaseTests, PairwiseNarrowPhaseVisitsPairsOnce) {
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {100, 100}};
+    TestEcs serialEcs;
+    addTestCircles(serialEcs, 2.5f);
+    PhysimCpp<TestEcs, OctreeBroadphase, PairwiseNarrowPhase> serial(
+            serialEcs, worldBoundrarys, PhysimConfig{.NrThreads=1, .QueryParts=1, .AsyncQuery=false, .RecordContacts=true});
+    TestEcs ecs;
+    addTestCircles(ecs, 2.5f);
+    PhysimCpp<TestEcs, OctreeBroadphase, PairwiseNarrowPhase> parallel(
+            ecs, worldBoundrarys, PhysimConfig{.NrThreads=4, .QueryParts=8, .AsyncQuery=false, .RecordContacts=true});
+    for (int step = 0; step < 20; step++) {
+        serial.Run(0.01f);
+        parallel.Run(0.01f);
+
+        auto key = [](const ContactEvent &contact) {
+            EXPECT_LT(contact.Id1.GetId(), contact.Id2.GetId());
+            return std::tuple(contact.Substep, contact.Id1.GetId(), contact.Id2.GetId());
+        };
+        std::vector<std::tuple<int, size_t, size_t>> serialPairs;
+        for (const auto &contact: serial.GetContacts()) {
+            serialPairs.push_back(key(contact));
+        }
+        std::vector<std::tuple<int, size_t, size_t>> parallelPairs;
+        for (const auto &contact: parallel.GetContacts()) {
+            parallelPairs.push_back(key(contact));
+        }
+        std::sort(serialPairs.begin(), serialPairs.end());
+        std::sort(parallelPairs.begin(), parallelPairs.end());
+        ASSERT_TRUE(std::adjacent_find(serialPairs.begin(), serialPairs.end()) == serialPairs.end());
+        ASSERT_EQ(serialPairs, parallelPairs);
+    }
+    ASSERT_GT(serial.GetContacts().size(), 0);
+
+    auto serialIt = serialEcs.GetSystem<Verlet>().begin();
+    for (const auto &[verlet]: ecs.GetSystem<Verlet>()) {
+        const auto &[serialVerlet] = *serialIt;
+        ASSERT_NEAR(verlet.Position.x, serialVerlet.Position.x, 1e-3);
+        ASSERT_NEAR(verlet.Position.y, serialVerlet.Position.y, 1e-3);
+        ++serialIt;
+    }
+}
+
+TEST(NarrowPhaseTests, PairwiseNarrowPhaseConservesMomentum) {
+    TestEcs ecs;
+    // The middle circle touches three others, each of them only the middle one.
+    const std::array<std::pair<sf::Vector2f, sf::Vector2f>, 4> circles{{
+            {{50, 50}, {0, 0}}, {{47.2f, 50}, {20, 0}}, {{52.8f, 50}, {-10, 5}}, {{50, 52.8f}, {3, -30}}}};
+    for (const auto &[pos, velocity]: circles) {
+        ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, velocity, pos}, octreeQuery{});
+    }
+    auto momentum = [&]() {
+        sf::Vector2f sum;
+        for (const auto &[verlet]: ecs.GetSystem<Verlet>()) {
+            sum += verlet.Velocity * verlet.Mass;
+        }
+        return sum;
+    };
+    const auto before = momentum();
+    PhysimCpp<TestEcs, OctreeBroadphase, PairwiseNarrowPhase> physim(
+            ecs, WorldBoundrarys{{0, 0}, {100, 100}}, PhysimConfig{.NrThreads=1, .AsyncQuery=false, .RecordContacts=true});
+    physim.Run(0.001f);
+    ASSERT_GE(physim.GetContacts().size(), 3);
+    ASSERT_NEAR(momentum().x, before.x, 1e-3f);
+    ASSERT_NEAR(momentum().y, before.y, 1e-3f);
+}
+
+TEST(NarrowPhaseTests, PairwiseNarrowPhaseSolvesOneSidedPairs) {
+    TestEcs ecs;
+    // The small circle's query does not reach the large one's center, only the large circle lists the pair.
+    const auto small = ecs.BuildEntity(Circle{.Radius=0.5f}, Verlet{{50, 50}, {0, 0}, {0, 0}, {50, 50}}, octreeQuery{});
+    const auto large = ecs.BuildEntity(Circle{.Radius=5.0f}, Verlet{{55, 50}, {0, 0}, {0, 0}, {55, 50}}, octreeQuery{});
+    PhysimCpp<TestEcs, OctreeBroadphase, PairwiseNarrowPhase> physim(
+            ecs, WorldBoundrarys{{0, 0}, {100, 100}}, PhysimConfig{.NrThreads=1, .AsyncQuery=false, .RecordContacts=true});
+    physim.Run(0.001f);
+    ASSERT_TRUE(std::none_of(ecs.Get<octreeQuery>(small).begin(), ecs.Get<octreeQuery>(small).end(),
+                             [&](const auto &other) { return other.Data == large; }));
+    ASSERT_FALSE(physim.GetContacts().empty());
+    ASSERT_EQ(physim.GetContacts().front().Id1, small);
+    ASSERT_EQ(physim.GetContacts().front().Id2, large);
+    ASSERT_LT(ecs.Get<Verlet>(small).Position.x, 50.0f);
+    ASSERT_GT(ecs.Get<Verlet>(large).Position.x, 55.0f);
+}
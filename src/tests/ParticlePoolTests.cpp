@@ -0,0 +1,66 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../ParticlePool.h"
+#include "../PhysimCpp.h"
+
+TEST(ParticlePoolTests, ParticlePoolRecyclesEmittedCircles) {
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {100, 100}};
+    ECS ecs;
+    ParticlePool pool(ecs, worldBoundrarys, 7);
+    ecs.BuildEntity(Emitter{.Rate=15.0f, .Region={{40, 10}, {20, 5}}, .Velocity={0, 10}, .Spread={2, 0},
+                            .Particle={.Radius=circleRadius}});
+    pool.Emit(0.1f);
+    pool.Emit(0.1f);
+    ASSERT_EQ(ecs.Size(), 4);
+
+    auto escape = [&]() {
+        std::vector<ecs::EntityID> escaped;
+        for (const auto &[circle, verlet, id]: ecs.GetSystem<Circle, Verlet, ecs::EntityID>()) {
+            if (!pool.IsParked(id)) {
+                ASSERT_GE(verlet.Position.x, 40.0f);
+                ASSERT_LE(verlet.Position.x, 60.0f);
+                ASSERT_GE(verlet.Velocity.y, 10.0f);
+                verlet.Position.y = 150.0f;
+                escaped.push_back(id);
+            }
+        }
+        for (const auto &id: escaped) {
+            pool.Release(id);
+            pool.Release(id);
+        }
+    };
+    escape();
+    ASSERT_EQ(pool.GetNrFree(), 3);
+    for (const auto &[circle, verlet]: ecs.GetSystem<Circle, Verlet>()) {
+        ASSERT_EQ(circle.Radius, 0.0f);
+        ASSERT_FALSE(worldBoundrarys.GetBox().contains(verlet.Position));
+    }
+
+    // Steady state, every emitted circle reuses a parked entity.
+    for (int frame = 0; frame < 10; frame++) {
+        pool.Emit(0.1f);
+        escape();
+    }
+    ASSERT_EQ(ecs.Size(), 4);
+    pool.Emit(0.2f);
+    ASSERT_EQ(ecs.Size(), 4);
+    ASSERT_EQ(pool.GetNrFree(), 0);
+
+    PhysimCpp physim(ecs, worldBoundrarys, PhysimConfig{.NrThreads=1, .AsyncQuery=false});
+    pool.Emit(0.1f);
+    physim.Run(0.01f);
+    ASSERT_EQ(ecs.Size(), 5);
+
+    // Parked circles stay where they were parked and are neither stepped nor queried.
+    for (const auto &[id]: ecs.GetSystem<ecs::EntityID>()) {
+        pool.Release(id);
+    }
+    physim.Run(0.01f);
+    ASSERT_EQ(physim.GetStats().ParticleSteps, 0);
+    for (const auto &[circle, verlet, query]: ecs.GetSystem<Circle, Verlet, octreeQuery>()) {
+        ASSERT_TRUE(verlet.Parked);
+        ASSERT_EQ(verlet.Position, verlet.PreviousPosition);
+        ASSERT_EQ(verlet.Velocity, sf::Vector2f(0, 0));
+        ASSERT_TRUE(query.empty());
+    }
+}
@@ -0,0 +1,306 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../PhysimCpp.h"
+#include "../PhysimBatch.h"
+#include "../FrameScheduler.h"
+#include "../PairwiseNarrowPhase.h"
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+struct FrozenIntegrator {
+    void Accelerate(Verlet &, float) const {}
+
+    void Step(Verlet &verlet, float) const {
+        verlet.PreviousPosition = verlet.Position;
+    }
+};
+
+sf::Vector2f runFastParticle(TestEcs &ecs, int stepLevels) {
+    for (int x = 0; x < 10; x++) {
+        for (int y = 0; y < 10; y++) {
+            sf::Vector2f pos{10.0f + x * 4.0f, 10.0f + y * 4.0f};
+            ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+        }
+    }
+    sf::Vector2f pos{80, 80};
+    const auto fast = ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {90, 0}, pos}, octreeQuery{});
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {200, 200}},
+                     PhysimConfig{.NrIterations=8, .NrThreads=1, .AsyncQuery=false, .StepLevels=stepLevels});
+    physim.Run(0.01f);
+    if (stepLevels == 1) {
+        EXPECT_EQ(physim.GetStats().ParticleSteps, 101 * 8);
+    } else {
+        // The resting grid steps once on the coarsest level, the fast particle every second substep.
+        EXPECT_EQ(physim.GetStats().ParticleSteps, 100 + 4);
+    }
+    return ecs.Get<Verlet>(fast).Position;
+}
+
+}
+
+TEST(PhysimCppTests, PhysimCustomPolicy) {
+    TestEcs ecs;
+    sf::Vector2f pos = {50, 50};
+    ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 10}, {10, 0}, pos}, octreeQuery{});
+    PhysimCpp<decltype(ecs), OctreeBroadphase, AveragedNarrowPhase, FrozenIntegrator> physim(
+            ecs, WorldBoundrarys{{0, 0}, {100, 100}}, PhysimConfig{.NrIterations=4, .AsyncQuery=false});
+    physim.Run(0.1f);
+    for (const auto &[verlet]: ecs.GetSystem<Verlet>()) {
+        ASSERT_EQ(verlet.Position.x, pos.x);
+        ASSERT_EQ(verlet.Position.y, pos.y);
+    }
+}
+
+TEST(PhysimCppTests, BatchMatchesSerialWorld) {
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {100, 100}};
+    ThreadPool pool(4);
+    PhysimBatch<TestEcs> batch(pool);
+    for (int i = 0; i < 8; i++) {
+        addTestCircles(batch.GetEcs(batch.AddWorld(worldBoundrarys)), 2.5f + i * 0.1f);
+    }
+    batch.Step(0.01f, 20);
+
+    for (size_t world = 0; world < batch.Size(); world++) {
+        TestEcs ecs;
+        addTestCircles(ecs, 2.5f + world * 0.1f);
+        PhysimCpp physim(ecs, worldBoundrarys, PhysimBatch<TestEcs>::DefaultConfig());
+        for (int step = 0; step < 20; step++) {
+            physim.Run(0.01f);
+        }
+        auto expected = ecs.GetSystem<Verlet>().begin();
+        for (const auto &[verlet]: batch.GetEcs(world).GetSystem<Verlet>()) {
+            const auto &[expectedVerlet] = *expected;
+            ASSERT_EQ(verlet.Position.x, expectedVerlet.Position.x);
+            ASSERT_EQ(verlet.Position.y, expectedVerlet.Position.y);
+            ++expected;
+        }
+    }
+}
+
+TEST(PhysimCppTests, BroadphaseSnapshot) {
+    TestEcs ecs;
+    addTestCircles(ecs, 2.5f);
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}},
+                     PhysimConfig{.AsyncQuery=false, .CollectSnapshot=true});
+    physim.Run(0.01f);
+    auto snapshot = physim.GetBroadphaseSnapshot();
+    ASSERT_EQ(snapshot.Density.size(), snapshot.Columns * snapshot.Rows);
+    ASSERT_EQ(std::accumulate(snapshot.Density.begin(), snapshot.Density.end(), 0u), 100u);
+    ASSERT_GE(std::accumulate(snapshot.Neighbours.begin(), snapshot.Neighbours.end(), 0u), 100u);
+    ASSERT_FALSE(snapshot.Cells.empty());
+}
+
+TEST(PhysimCppTests, VerletSkinRebuildsOnDisplacement) {
+    TestEcs ecs;
+    addTestCircles(ecs, 3.5f);
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}}, PhysimConfig{.NrThreads=1, .Skin=4.0f});
+    auto assertTouchingListed = [&]() {
+        for (const auto &[verlet1, circle1, id1, query]: ecs.GetSystem<Verlet, Circle, ecs::EntityID, octreeQuery>()) {
+            for (const auto &[verlet2, circle2, id2]: ecs.GetSystem<Verlet, Circle, ecs::EntityID>()) {
+                if (id1 == id2 || sf::getLength(verlet1.Position - verlet2.Position) > circle1.Radius + circle2.Radius) {
+                    continue;
+                }
+                ASSERT_TRUE(std::any_of(query.begin(), query.end(), [&](const auto &other) { return other.Data == id2; }));
+            }
+        }
+    };
+    for (int frame = 0; frame < 10; frame++) {
+        physim.Run(0.001f);
+        assertTouchingListed();
+    }
+    ASSERT_EQ(physim.GetStats().QueryRebuilds, 1);
+    ASSERT_LT(physim.GetStats().MaxDisplacement, 2.0f);
+
+    // Overlap pushes outrun a small skin within a frame, the lists are rebuilt between substeps as well.
+    physim.SetConfig(PhysimConfig{.NrThreads=1, .Skin=0.1f});
+    for (int frame = 0; frame < 10; frame++) {
+        physim.Run(0.001f);
+        assertTouchingListed();
+    }
+    const auto rebuilds = physim.GetStats().QueryRebuilds;
+    ASSERT_GT(rebuilds, 11);
+    ASSERT_DOUBLE_EQ(physim.GetStats().RebuildRate, rebuilds / 20.0);
+}
+
+TEST(PhysimCppTests, InvalidatedQueryDropsRemovedCircles) {
+    TestEcs ecs;
+    addTestCircles(ecs, 2.9f);
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}}, PhysimConfig{.NrThreads=2, .AsyncQuery=true});
+    physim.Run(0.001f);
+    physim.Run(0.001f);
+    physim.InvalidateQuery();
+    const auto removed = std::get<0>(*ecs.GetSystem<ecs::EntityID>().begin());
+    ecs.RemoveEntity(removed);
+    const auto rebuilds = physim.GetStats().QueryRebuilds;
+    physim.Run(0.001f);
+    ASSERT_GT(physim.GetStats().QueryRebuilds, rebuilds);
+    for (const auto &[query]: ecs.GetSystem<octreeQuery>()) {
+        ASSERT_TRUE(std::none_of(query.begin(), query.end(), [&](const auto &other) { return other.Data == removed; }));
+    }
+}
+
+TEST(PhysimCppTests, PhysimTasksMatchRun) {
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {100, 100}};
+    const PhysimConfig config{.NrThreads=1, .QueryParts=1, .AsyncQuery=false};
+    TestEcs expected;
+    addTestCircles(expected, 2.5f);
+    PhysimCpp serial(expected, worldBoundrarys, config);
+    TestEcs ecs;
+    addTestCircles(ecs, 2.5f);
+    PhysimCpp scheduled(ecs, worldBoundrarys, config);
+
+    ThreadPool pool(4);
+    FrameScheduler scheduler(pool);
+    float dt = 0.01f;
+    scheduled.AddTasks(scheduler, dt, 4);
+    for (int step = 0; step < 20; step++) {
+        serial.Run(dt);
+        scheduler.Run();
+    }
+    auto expectedIt = expected.GetSystem<Verlet>().begin();
+    for (const auto &[verlet]: ecs.GetSystem<Verlet>()) {
+        const auto &[expectedVerlet] = *expectedIt;
+        ASSERT_EQ(verlet.Position.x, expectedVerlet.Position.x);
+        ASSERT_EQ(verlet.Position.y, expectedVerlet.Position.y);
+        ++expectedIt;
+    }
+}
+
+TEST(PhysimCppTests, ContactStreamRecordsPairsAndLines) {
+    TestEcs ecs;
+    sf::Vector2f pos1{50, 50};
+    sf::Vector2f pos2{52, 50};
+    sf::Vector2f pos3{20, 49};
+    const auto id1 = ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos1, {0, 0}, {0, 0}, pos1}, octreeQuery{});
+    const auto id2 = ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos2, {0, 0}, {0, 0}, pos2}, octreeQuery{});
+    const auto id3 = ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos3, {0, 0}, {0, 50}, pos3}, octreeQuery{});
+    const auto lineId = ecs.BuildEntity(Line{{10, 50}, {30, 50}, {0, 1}});
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}},
+                     PhysimConfig{.NrIterations=1, .NrThreads=1, .AsyncQuery=false});
+    physim.Run(0.01f);
+    ASSERT_TRUE(physim.GetContacts().empty());
+
+    physim.SetConfig(PhysimConfig{.NrIterations=1, .NrThreads=1, .AsyncQuery=false, .RecordContacts=true});
+    physim.Run(0.01f);
+    const auto contacts = physim.GetContacts();
+    ASSERT_TRUE(std::any_of(contacts.begin(), contacts.end(), [&](const ContactEvent &contact) {
+        return !contact.LineContact && contact.Penetration > 0.0f &&
+               ((contact.Id1 == id1 && contact.Id2 == id2) || (contact.Id1 == id2 && contact.Id2 == id1));
+    }));
+    ASSERT_TRUE(std::any_of(contacts.begin(), contacts.end(), [&](const ContactEvent &contact) {
+        return contact.LineContact && contact.Id1 == id3 && contact.Id2 == lineId && contact.Impulse > 0.0f;
+    }));
+    for (const auto &contact: contacts) {
+        ASSERT_NEAR(sf::getLength(contact.Normal), 1.0f, 1e-4);
+    }
+}
+
+TEST(PhysimCppTests, DiagnosticsMatchSeparatePasses) {
+    TestEcs ecs;
+    addTestCircles(ecs, 2.5f);
+    ecs.BuildEntity(Line{{0, 40}, {100, 40}, {0, -1}});
+    PhysimCpp<TestEcs, OctreeBroadphase, PairwiseNarrowPhase> physim(
+            ecs, WorldBoundrarys{{0, 0}, {100, 100}},
+            PhysimConfig{.NrThreads=4, .AsyncQuery=false, .RecordContacts=true, .Diagnostics=true});
+    int contacts = 0;
+    for (int frame = 0; frame < 30; frame++) {
+        physim.Run(0.01f);
+        double energy = 0.0;
+        sf::Vector2<double> momentum;
+        for (const auto &[verlet]: ecs.GetSystem<Verlet>()) {
+            const sf::Vector2<double> velocity{verlet.Velocity};
+            energy += 0.5 * verlet.Mass * (velocity.x * velocity.x + velocity.y * velocity.y);
+            momentum += velocity * static_cast<double>(verlet.Mass);
+        }
+        const auto &diagnostics = physim.GetStats().Diagnostics;
+        ASSERT_NEAR(diagnostics.KineticEnergy, energy, 1e-9 * std::max(energy, 1.0));
+        ASSERT_NEAR(diagnostics.Momentum.x, momentum.x, 1e-9 * std::max(std::abs(momentum.x), 1.0));
+        ASSERT_NEAR(diagnostics.Momentum.y, momentum.y, 1e-9 * std::max(std::abs(momentum.y), 1.0));
+
+        int lineContacts = 0;
+        float maxPenetration = 0.0f;
+        for (const auto &contact: physim.GetContacts()) {
+            lineContacts += contact.LineContact;
+            maxPenetration = std::max(maxPenetration, contact.Penetration);
+        }
+        ASSERT_EQ(diagnostics.Contacts + diagnostics.LineContacts, physim.GetContacts().size());
+        ASSERT_EQ(diagnostics.LineContacts, lineContacts);
+        ASSERT_EQ(diagnostics.MaxPenetration, maxPenetration);
+        contacts += diagnostics.Contacts;
+    }
+    ASSERT_GT(contacts, 0);
+}
+
+TEST(PhysimCppTests, MemoryReportTracksSubsystems) {
+    MemoryAccount account;
+    {
+        TrackedVector<int> values{TrackingAllocator<int>(&account)};
+        values.reserve(100);
+        ASSERT_EQ(account.GetLive(), values.capacity() * sizeof(int));
+        ASSERT_EQ(account.GetAllocations(), 1);
+    }
+    ASSERT_EQ(account.GetLive(), 0);
+    ASSERT_EQ(account.GetPeak(), 100 * sizeof(int));
+
+    TestEcs ecs;
+    addTestCircles(ecs, 2.5f);
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}},
+                     PhysimConfig{.NrThreads=1, .AsyncQuery=false, .RecordContacts=true});
+    for (int frame = 0; frame < 50; frame++) {
+        physim.Run(0.01f);
+    }
+    const auto report = physim.GetMemoryReport();
+    auto find = [&](const std::string& name) {
+        return *std::find_if(report.begin(), report.end(), [&](const auto& usage) { return usage.Name == name; });
+    };
+    const auto broadphase = find("broadphase");
+    ASSERT_GT(broadphase.Live, 0);
+    ASSERT_GT(broadphase.Allocations, 0);
+    ASSERT_EQ(broadphase.FrameAllocations, 0);
+    ASSERT_EQ(find("scratch").FrameAllocations, 0);
+    ASSERT_GE(find("components").Live, 100 * (sizeof(Circle) + sizeof(Verlet)));
+    const auto neighbours = find("neighbour lists");
+    ASSERT_GT(neighbours.Live, 0);
+    ASSERT_GT(neighbours.Allocations, 0);
+    ASSERT_FALSE(neighbours.Sampled);
+    ASSERT_GE(neighbours.Peak, neighbours.Live);
+    ASSERT_GT(find("solver").Allocations, 0);
+
+    std::ostringstream out;
+    PrintMemoryReport(out, report);
+    ASSERT_NE(out.str().find("broadphase"), std::string::npos);
+}
+
+TEST(PhysimCppTests, StepLevelsSkipRestingParticles) {
+    TestEcs uniform;
+    TestEcs adaptive;
+    const auto expected = runFastParticle(uniform, 1);
+    const auto position = runFastParticle(adaptive, 4);
+    ASSERT_NEAR(position.x, expected.x, 1e-4);
+    ASSERT_NEAR(position.y, expected.y, 1e-4);
+    auto expectedIt = uniform.GetSystem<Verlet>().begin();
+    for (const auto &[verlet]: adaptive.GetSystem<Verlet>()) {
+        const auto &[expectedVerlet] = *expectedIt;
+        ASSERT_NEAR(verlet.Position.x, expectedVerlet.Position.x, 1e-4);
+        ASSERT_NEAR(verlet.Position.y, expectedVerlet.Position.y, 1e-4);
+        ++expectedIt;
+    }
+}
+
+TEST(PhysimCppTests, StepLevelsSpreadAlongContactChains) {
+    TestEcs ecs;
+    // Built from the far end, so a single pass in id order would only lower the circle next to the fast one.
+    for (int i = 4; i > 0; i--) {
+        sf::Vector2f pos{50.0f + i * 2.9f, 50.0f};
+        ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+    }
+    sf::Vector2f pos{50, 50};
+    ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 90}, pos}, octreeQuery{});
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {200, 200}},
+                     PhysimConfig{.NrIterations=8, .NrThreads=1, .AsyncQuery=false, .StepLevels=4});
+    physim.Run(0.04f);
+    // The fast circle steps every substep, then each circle along the chain one level coarser.
+    ASSERT_EQ(physim.GetStats().ParticleSteps, 8 + 4 + 2 + 1 + 1);
+}
@@ -0,0 +1,62 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../PhysimCpp.h"
+#include "../StateExport.h"
+#include <random>
+
+TEST(StateExportTests, StateExportPublishesFrames) {
+    const auto name = "/physim-test-" + std::to_string(std::random_device{}());
+    StateExporter exporter(name, 8, 2);
+    StateExportReader reader(name);
+    ASSERT_FALSE(reader.ReadLatest([](auto, auto, auto) { FAIL(); }));
+
+    TestEcs ecs;
+    for (int i = 0; i < 10; i++) {
+        sf::Vector2f pos{10.0f + 5.0f * i, 50};
+        ecs.BuildEntity(Circle{.Radius=circleRadius, .Color=sf::Color(1, 2, 3, 4)}, Verlet{pos, {0, 0}, {0, 0}, pos},
+                        octreeQuery{});
+    }
+    PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}}, PhysimConfig{.NrThreads=1, .AsyncQuery=false});
+    physim.SetExporter(&exporter);
+    physim.Run(0.01f);
+    physim.Run(0.01f);
+    ASSERT_EQ(reader.GetPublished(), 2);
+
+    std::vector<ExportedParticle> particles;
+    ASSERT_TRUE(reader.ReadLatest([&](std::span<const ExportedParticle> frame, uint64_t number, uint32_t total) {
+        particles.assign(frame.begin(), frame.end());
+        ASSERT_EQ(number, 1);
+        ASSERT_EQ(total, 10);
+    }));
+    ASSERT_EQ(particles.size(), 8);
+    auto it = particles.begin();
+    for (const auto &[circle, verlet]: ecs.GetSystem<Circle, Verlet>()) {
+        if (it == particles.end()) {
+            break;
+        }
+        ASSERT_EQ(it->X, verlet.Position.x);
+        ASSERT_EQ(it->Y, verlet.Position.y);
+        ASSERT_EQ(it->Radius, circle.Radius);
+        ASSERT_EQ(it->Color, 0x01020304u);
+        ++it;
+    }
+
+    // The writer wraps around onto the slot being read, the reader has to notice.
+    ASSERT_FALSE(reader.ReadLatest([&](auto, auto, auto) {
+        exporter.BeginFrame();
+        exporter.EndFrame(0, 0);
+        exporter.BeginFrame();
+    }));
+    exporter.EndFrame(0, 0);
+    ASSERT_TRUE(reader.ReadLatest([](auto frame, auto number, auto) {
+        ASSERT_TRUE(frame.empty());
+        ASSERT_EQ(number, 3);
+    }));
+
+    // A second exporter with the same name leaves the first one's object alone.
+    ASSERT_THROW(StateExporter(name, 8, 2), std::runtime_error);
+    ASSERT_TRUE(reader.ReadLatest([](auto, auto number, auto) {
+        ASSERT_EQ(number, 3);
+    }));
+    ASSERT_NO_THROW(StateExportReader{name});
+}
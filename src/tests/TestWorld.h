@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Util.h"
+#include <filesystem>
+#include <random>
+#include <string>
+
+using TestEcs = ecs::ECSManager<ecs::EntityID, Verlet, Line, Circle, octreeQuery>;
+
+// A 10 by 10 grid of circles spacing apart, moving away from its centre.
+inline void addTestCircles(TestEcs &ecs, float spacing) {
+    for (int x = 0; x < 10; x++) {
+        for (int y = 0; y < 10; y++) {
+            sf::Vector2f pos{10.0f + x * spacing, 10.0f + y * spacing};
+            ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {x - 5.0f, y - 5.0f}, pos}, octreeQuery{});
+        }
+    }
+}
+
+// A name in the temp directory that test runs in parallel do not share.
+inline std::filesystem::path uniqueTempPath(const std::string &prefix) {
+    return std::filesystem::temp_directory_path() / (prefix + std::to_string(std::random_device{}()));
+}
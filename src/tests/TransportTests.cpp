@@ -0,0 +1,86 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../Domain.h"
+#include "../Transport.h"
+#include <cstring>
+#include <thread>
+
+namespace {
+
+void runSlabsInThreads(TransportType type) {
+    const SlabDecomposition decomposition{{{0, 0}, {100, 50}}, 2};
+    auto [left, right] = MakeChannels(type);
+    TestEcs ecs0;
+    TestEcs ecs1;
+    auto pos = sf::Vector2f{45, 25};
+    ecs0.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {50, 0}, pos}, octreeQuery{});
+    pos = sf::Vector2f{75, 25};
+    ecs1.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+
+    std::thread other([&, &right = right]() {
+        SlabWorker worker(ecs1, decomposition, 1, right.get(), nullptr, 5.0f);
+        for (int i = 0; i < 20; i++) {
+            worker.Step(0.01f);
+        }
+    });
+    SlabWorker worker(ecs0, decomposition, 0, nullptr, left.get(), 5.0f);
+    for (int i = 0; i < 20; i++) {
+        worker.Step(0.01f);
+    }
+    other.join();
+
+    ASSERT_EQ(ecs0.Size(), 0);
+    ASSERT_EQ(ecs1.Size(), 2);
+}
+
+// Every slab sends its number up and checks the one from below, only the parent may use gtest.
+bool passSlabNumbers(int nrSlabs, TransportType type) {
+    return RunSlabProcesses(nrSlabs, type, [](int slab, Channel *lower, Channel *upper) {
+        std::vector<std::byte> message;
+        if (upper) {
+            upper->Send(std::as_bytes(std::span(&slab, 1)));
+        }
+        if (lower) {
+            lower->Receive(message);
+            int received = -1;
+            std::memcpy(&received, message.data(), std::min(message.size(), sizeof(received)));
+            if (received != slab - 1) {
+                throw std::runtime_error("wrong slab number");
+            }
+        }
+    });
+}
+
+}
+
+TEST(TransportTests, SlabMigrationOverUnixSocket) {
+    runSlabsInThreads(TransportType::UnixSocket);
+}
+
+TEST(TransportTests, SlabMigrationOverSharedMemory) {
+    runSlabsInThreads(TransportType::SharedMemory);
+}
+
+TEST(TransportTests, SlabProcessesOverUnixSocket) {
+    ASSERT_TRUE(passSlabNumbers(3, TransportType::UnixSocket));
+}
+
+TEST(TransportTests, SlabProcessesOverSharedMemory) {
+    ASSERT_TRUE(passSlabNumbers(3, TransportType::SharedMemory));
+}
+
+TEST(TransportTests, SlabProcessesSeeExitedNeighbours) {
+    // Slab 0 leaves without a word, slab 1 has to get an error rather than a SIGPIPE or a Receive that never
+    // returns because slab 2 or the parent still hold slab 0's end.
+    const bool success = RunSlabProcesses(3, TransportType::UnixSocket, [](int slab, Channel *lower, Channel *) {
+        if (slab != 1) {
+            return;
+        }
+        std::vector<std::byte> message(1 << 20);
+        for (int i = 0; i < 64; i++) {
+            lower->Send(message);
+        }
+        lower->Receive(message);
+    });
+    ASSERT_FALSE(success);
+}
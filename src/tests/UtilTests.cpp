@@ -3,13 +3,16 @@
 //
 
 #include "../Physics.h"
-#include "Util.h"
+#include "TestWorld.h"
 #include <gtest/gtest.h>
 #include "SFML/System.hpp"
 #include "../PhysimCpp.h"
+#include "../Arena.h"
+#include "../Camera.h"
+#include "../FrameScheduler.h"
 
 TEST(UtilTests, PhysimCompile) {
-    ecs::ECSManager<ecs::EntityID, Verlet, Line, Circle, octreeQuery> ecs;
+    TestEcs ecs;
     PhysimCpp physim(ecs, WorldBoundrarys{{0, 0}, {100, 100}});
     physim.Run(0.1f);
 }
@@ -24,6 +27,88 @@ TEST(UtilTests, PhysimWontCompile) {
     physim.Run(0.1f);
     */
 }
+
+TEST(UtilTests, ThreadPoolParallelFor) {
+    ThreadPool pool(4);
+    std::vector<int> values(1000, 0);
+    pool.ParallelFor(values.size(), [&](size_t i, size_t worker) {
+        ASSERT_LT(worker, pool.Size());
+        values[i] = static_cast<int>(i);
+    });
+    for (size_t i = 0; i < values.size(); i++) {
+        ASSERT_EQ(values[i], i);
+    }
+}
+
+TEST(UtilTests, FrameArenaRecyclesBlocks) {
+    FrameArena arena(256);
+    for (int frame = 0; frame < 3; frame++) {
+        std::pmr::vector<int> values(&arena);
+        values.reserve(100);
+        auto small = static_cast<double *>(arena.allocate(sizeof(double), alignof(double)));
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(small) % alignof(double), 0);
+        ASSERT_GE(arena.GetUsed(), 100 * sizeof(int) + sizeof(double));
+        values = std::pmr::vector<int>(&arena);
+        arena.Reset();
+        ASSERT_EQ(arena.GetUsed(), 0);
+    }
+    const auto capacity = arena.GetCapacity();
+    arena.allocate(capacity / 2, 8);
+    arena.Reset();
+    ASSERT_EQ(arena.GetCapacity(), capacity);
+}
+
+TEST(UtilTests, FrameSchedulerKeepsConflictOrder) {
+    ThreadPool pool(4);
+    FrameScheduler scheduler(pool);
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&](std::string name) {
+        return [&, name]() {
+            std::lock_guard lock(mutex);
+            order.push_back(name);
+        };
+    };
+    const auto gravity0 = scheduler.Add({.Name="gravity0", .Writes=Components<Verlet>(), .Chunk=0, .Run=record("gravity0")});
+    const auto gravity1 = scheduler.Add({.Name="gravity1", .Writes=Components<Verlet>(), .Chunk=1, .Run=record("gravity1")});
+    const auto lines = scheduler.Add({.Name="lines", .Writes=Components<Line>(), .Run=record("lines")});
+    const auto velocity0 = scheduler.Add({.Name="velocity0", .Writes=Components<Verlet>(), .Chunk=0, .Run=record("velocity0")});
+    const auto solve = scheduler.Add({.Name="solve", .Reads=Components<Line>(), .Writes=Components<Verlet>(), .Run=record("solve")});
+
+    scheduler.Run();
+    scheduler.Run();
+    ASSERT_EQ(order.size(), 2 * scheduler.Size());
+
+    ASSERT_FALSE(scheduler.DependsOn(gravity1, gravity0));
+    ASSERT_FALSE(scheduler.DependsOn(lines, gravity0));
+    ASSERT_TRUE(scheduler.DependsOn(velocity0, gravity0));
+    ASSERT_FALSE(scheduler.DependsOn(velocity0, gravity1));
+    for (const auto task: {gravity0, gravity1, lines, velocity0}) {
+        ASSERT_TRUE(scheduler.DependsOn(solve, task));
+    }
+
+    auto position = [&](const std::string &name) {
+        return std::find(order.begin(), order.begin() + scheduler.Size(), name) - order.begin();
+    };
+    ASSERT_LT(position("gravity0"), position("velocity0"));
+    for (const auto *name: {"gravity0", "gravity1", "lines", "velocity0"}) {
+        ASSERT_LT(position(name), position("solve"));
+    }
+}
+
+TEST(UtilTests, CameraZoomKeepsAnchor) {
+    Camera camera(WorldBoundrarys{{0, 0}, {1000, 500}}, {1000, 500});
+    ASSERT_FLOAT_EQ(camera.GetVisibleArea().width, 1000.0f);
+    const auto anchor = camera.ToWorld({250, 100});
+    camera.Zoom(4.0f, {250, 100});
+    ASSERT_NEAR(camera.ToWorld({250, 100}).x, anchor.x, 1e-3);
+    ASSERT_NEAR(camera.ToWorld({250, 100}).y, anchor.y, 1e-3);
+    ASSERT_FLOAT_EQ(camera.GetVisibleArea().width, 250.0f);
+
+    camera.Pan({100, 0});
+    ASSERT_NEAR(camera.ToWorld({250, 100}).x, anchor.x - 25.0f, 1e-3);
+}
+
 /*
 
 TEST(UtilTests, Projection2) {
@@ -0,0 +1,95 @@
+#include "TestWorld.h"
+#include <gtest/gtest.h>
+#include "../WorldPager.h"
+
+namespace {
+
+void pageRestingGroup(const std::filesystem::path &directory) {
+    TestEcs ecs;
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {1000, 1000}};
+    std::vector<sf::Vector2f> resting;
+    for (int i = 0; i < 10; i++) {
+        sf::Vector2f pos{850.0f + i * 4.0f, 850.0f};
+        resting.push_back(pos);
+        ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+        pos = {50.0f + i * 4.0f, 50.0f};
+        ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {10, 0}, pos}, octreeQuery{});
+    }
+    WorldPager pager(ecs, worldBoundrarys, {.ChunkSize=100.0f, .IdleUpdates=3, .Directory=directory});
+    for (int i = 0; i < 3; i++) {
+        pager.Update();
+    }
+    ASSERT_EQ(ecs.Size(), 10);
+    ASSERT_EQ(pager.GetPagedParticles(), 10);
+    ASSERT_EQ(pager.GetResidentChunks(), 4);
+
+    pager.Touch({840, 840, 10, 10});
+    pager.Update();
+    ASSERT_EQ(ecs.Size(), 20);
+    ASSERT_EQ(pager.GetPagedParticles(), 0);
+    std::vector<sf::Vector2f> positions;
+    for (const auto &[verlet]: ecs.GetSystem<Verlet>()) {
+        positions.push_back(verlet.Position);
+    }
+    for (const auto &pos: resting) {
+        ASSERT_NE(std::find(positions.begin(), positions.end(), pos), positions.end());
+    }
+}
+
+}
+
+TEST(WorldPagerTests, WorldPagerPagesRestingChunksInMemory) {
+    pageRestingGroup({});
+}
+
+TEST(WorldPagerTests, WorldPagerPagesRestingChunksToFiles) {
+    const auto directory = uniqueTempPath("physim-pager-test-");
+    std::filesystem::create_directories(directory);
+    pageRestingGroup(directory);
+    ASSERT_TRUE(std::filesystem::is_empty(directory));
+    std::filesystem::remove_all(directory);
+}
+
+TEST(WorldPagerTests, WorldPagerKeepsChunksRestingParticlesLeanOn) {
+    TestEcs ecs;
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {1000, 1000}};
+    sf::Vector2f pos{50, 50};
+    ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {10, 0}, pos}, octreeQuery{});
+    // A resting row from the active chunks across two idle ones, and a resting group on its own.
+    for (float x = 190.0f; x < 310.0f; x += 2 * circleRadius) {
+        pos = {x, 50.0f};
+        ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+    }
+    pos = {850, 850};
+    ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+    const size_t count = ecs.Size();
+    int changes = 0;
+    WorldPager pager(ecs, worldBoundrarys, {.ChunkSize=100.0f, .IdleUpdates=3, .BeforeChange=[&]() { changes++; }});
+    for (int i = 0; i < 3; i++) {
+        pager.Update();
+    }
+    ASSERT_EQ(pager.GetResidentChunks(), 6);
+    ASSERT_EQ(pager.GetPagedParticles(), 1);
+    ASSERT_EQ(ecs.Size(), count - 1);
+    ASSERT_EQ(changes, 1);
+}
+
+TEST(WorldPagerTests, WorldPagerKeepsRecordsItCouldNotWrite) {
+    TestEcs ecs;
+    const WorldBoundrarys worldBoundrarys{{0, 0}, {1000, 1000}};
+    const sf::Vector2f pos{850, 850};
+    ecs.BuildEntity(Circle{.Radius=circleRadius}, Verlet{pos, {0, 0}, {0, 0}, pos}, octreeQuery{});
+    const auto missing = uniqueTempPath("physim-missing-");
+    WorldPager pager(ecs, worldBoundrarys, {.ChunkSize=100.0f, .IdleUpdates=1, .Directory=missing});
+    pager.Update();
+    ASSERT_EQ(ecs.Size(), 0);
+    ASSERT_EQ(pager.GetPagedParticles(), 1);
+    ASSERT_GT(pager.GetPagedBytes(), 0);
+
+    pager.Touch({840, 840, 10, 10});
+    pager.Update();
+    ASSERT_EQ(ecs.Size(), 1);
+    for (const auto &[verlet]: ecs.GetSystem<Verlet>()) {
+        ASSERT_EQ(verlet.Position, pos);
+    }
+}